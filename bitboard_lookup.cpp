@@ -4,206 +4,164 @@
 
 #include <array>
 
-// Arrays of first-rank/file attacks, for slider move generation.
-// Indexed by the 8 possible slider locations, and 2^(8 - 2) = 64 non-edge
-// occupancy states.
-std::array<std::array<Bitboard, 64>, 8> firstRankAttacks{};
-std::array<std::array<Bitboard, 64>, 8> firstFileAttacks{};
-
-// Defining lookup arrays exposed in .h
-std::array<Bitboard, NUM_SQUARES> knightAttacks{};
-std::array<Bitboard, NUM_SQUARES> kingAttacks{};
-std::array<std::array<Bitboard, NUM_SQUARES>, NUM_COLOURS> pawnAttacks{};
-std::array<Bitboard, NUM_SQUARES> diagMasks{};
-std::array<Bitboard, NUM_SQUARES> antidiagMasks{};
-
-// Declaring auxiliary functions not exposed in .h
-void initialiseAllDiagMasks();
-void initialiseFirstFileAttacks();
-void initialiseFirstRankAttacks();
-void initialiseKingAttacks();
-void initialiseKnightAttacks();
-void initialisePawnAttacks();
-
-
-// === Lookup table initialiser ===
-void initialiseBbLookup() {
-    initialiseAllDiagMasks();
-    initialiseFirstRankAttacks();
-    initialiseFirstFileAttacks();
-    initialiseKingAttacks();
-    initialiseKnightAttacks();
-    initialisePawnAttacks();
-    return;
-}
-
-// === Sliding attack getters ===
-// bbPos contains all pieces of position.
-Bitboard findRankAttacks(Square sq, Bitboard bbPos) {
-    int irank {getRankIdx(sq)};
-    int ifile {getFileIdx(sq)};
-    Bitboard oc { bbPos & (BB_1 << (8*irank)) }; // extract just desired rank
-    // b-file multiplication puts desired bits on 8th rank to extract.
-    int ioc { static_cast<int>((oc * BB_B) >> (64 - 6)) };
-    return (BB_1 << (8*irank)) & firstRankAttacks[ifile][ioc];
-}
-
-Bitboard findDiagAttacks(Square sq, Bitboard bbPos) {
-    int ifile {getFileIdx(sq)};
-    Bitboard oc { bbPos & (diagMasks[sq]) }; // extract just desired diagonal
-    // b-file multiplication puts desired bits on 8th rank.
-    int ioc = { static_cast<int>((oc * BB_B) >> (64 - 6)) };
-    return diagMasks[sq] & firstRankAttacks[ifile][ioc];
-}
-
-Bitboard findAntidiagAttacks(Square sq, Bitboard bbPos) {
-    int ifile {getFileIdx(sq)};
-    Bitboard oc { bbPos & (antidiagMasks[sq]) };
-    // b-file multiplication puts desired bits on 8th rank.
-    int ioc = { static_cast<int>((oc * BB_B) >> (64-6)) };
-    return antidiagMasks[sq] & firstRankAttacks[ifile][ioc];
-}
-
-Bitboard findFileAttacks(Square sq, Bitboard bbPos) {
-    int irank {getRankIdx(sq)};
-    int ifile {getFileIdx(sq)};
-    Bitboard oc { (bbPos >> ifile) & BB_A }; // send desired file bits to a-file
-    // multiply by c2-h7 diagonal; flip multiplication extracts lookup index
-    int ioc { static_cast<int>(oc * 0x0080402010080400ULL >> (64-6)) };
-    return firstFileAttacks[irank][ioc] & (BB_A << ifile);
-}
-
-
-// === Auxiliary methods ===
-    
-// --- diagonal masks ---
-
-void initialiseAllDiagMasks() {
-    // Generates both diagMasks and antidiagMasks, indexed by Square.
-    // first define the S and W (anti: S and E) edges of the table
-    diagMasks[0] = BB_LONG_DIAG;
-    antidiagMasks[7] = BB_LONG_ANTIDIAG;
-    antidiagMasks[56] = BB_LONG_ANTIDIAG;
-    
-    for (int i = 1; i < 8; ++i) {
-        diagMasks[i] = shiftS(diagMasks[i - 1]);
-        diagMasks[8*i] = shiftN(diagMasks[8*i - 8]);
-        antidiagMasks[7 - i] = shiftS(antidiagMasks[8 - i]);
-        antidiagMasks[7 + 8*i] = shiftN(antidiagMasks[8*i - 1]);
+// === Slider backend selection ===
+// Picked during static initialisation; until then the zero-initialised value
+// (KINDERGARTEN) is used, which needs no runtime setup either.
+SliderBackend sliderBackend {detectSliderBackend()};
+
+bool isSliderBackendSupported(SliderBackend sb) {
+    switch (sb) {
+    case KINDERGARTEN: return true;
+    case MAGIC: return true;
+    case PEXT:
+#ifdef PEXT_COMPILABLE
+        __builtin_cpu_init(); // may run before libgcc's own constructor does
+        return __builtin_cpu_supports("bmi2");
+#else
+        return false;
+#endif
     }
-    // then propagate and fill in the rest of the table.    
-    for (int x = 1; x < 8; ++x) {
-        for (int y = 1; y < 8; ++y) {
-            diagMasks[x+8*y] = diagMasks[(x-1) + 8*(y-1)];
-            antidiagMasks[7-x+8*y] = antidiagMasks[(8-x) + 8*(y-1)];
-        }
-    }
-    return;
+    return false;
 }
 
-// --- 1st-rank and 1st-file attacks ---
-void initialiseFirstRankAttacks() {
-    for (int ioc = 0; ioc < 64; ++ioc) {
-         // +129 sets the end bits of rank to 1 (cannot attack past board edge)
-        Bitboard oc = (ioc << 1) + 129;
-        
-        // If slider at end of rank, that end must be handled differently.
-        // Therefore use two separate if conditions to isolate them.
-        for (int idx_r = 0; idx_r < 8; ++idx_r) {
-            int smallLimit {0}; // Westmost square attacked by the slider.
-            int bigLimit {7}; // Eastmost square attacked by the slider.
-            Bitboard r {bbFromSq(square(idx_r))};
-            if (idx_r != 0) {
-                // zero high bits, take highest set bit (lowest above slider).
-                smallLimit = gsb(oc & (r - 1));
-            } 
-            if (idx_r != 7) {
-                // zero low bits, take lowest set bit (highest below slider).
-                bigLimit = lsb(oc & ~((r << 1) - 1));
-            }
-            // Get bitboard of all bits between limits, inclusive.
-            Bitboard bb = ((bbFromSq(square(bigLimit)) << 1) -
-                           bbFromSq(square(smallLimit)));
-            bb ^= r; // slider does not attack itself
-            bb *= BB_A; // north-fill multiplication
-            firstRankAttacks[idx_r][ioc] = bb;
-        }
+SliderBackend detectSliderBackend() {
+    // Prefers PEXT where it is fast, then magic bitboards.
+#ifdef PEXT_COMPILABLE
+    if (isSliderBackendSupported(PEXT) &&
+        !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2")) {
+        return PEXT;
     }
-    return;
+#endif
+    return MAGIC;
 }
 
-
-void initialiseFirstFileAttacks() {
-    for (int ioc = 0; ioc < 64; ++ioc) {
-        // NOTE: Index 0 here is 8th rank of the real file!
-        // In first-rank terms, 1st rank is mapped to h1, 2nd rank to g1, etc.
-        // First we generate the attacks using a rank, taking into account the
-        // changed indices, then flip it later such that it is correct.
-        
-        // +129 sets the end bits of rank to 1 (cannot attack past board edge)
-        Bitboard oc = (ioc << 1) + 129;
-        
-        // If slider at end of rank, that end must be handled differently.
-        // Therefore use two separate if conditions to isolate them.
-        for (int idx_r = 0; idx_r < 8; ++idx_r) {
-            int smallLimit {0};
-            int bigLimit {7};
-            Bitboard r {bbFromSq(square(7 - idx_r))};
-            if (idx_r != 7) {
-                // zero high bits, take highest set bit (lowest above slider).
-                smallLimit = gsb(oc & (r - 1));
-            } 
-            if (idx_r != 0) {
-                // zero low bits, take lowest set bit (highest below slider).
-                bigLimit = lsb(oc & ~((r << 1) - 1));
-            }
-            // Get bitboard of all bits between limits, inclusive.
-            Bitboard bb = ((bbFromSq(square(bigLimit)) << 1) -
-                           bbFromSq(square(smallLimit)));
-            bb ^= r; // slider does not attack itself
-            bb = (bb * BB_LONG_DIAG) & BB_H; // rotate attacks to the h-file.
-            // Now fill left.
-            bb |= bb >> 1;
-            bb |= bb >> 2;
-            bb |= bb >> 4;
-            firstFileAttacks[idx_r][ioc] = bb;
-        }
+bool setSliderBackend(SliderBackend sb) {
+    if (!isSliderBackendSupported(sb)) {
+        return false;
     }
-    return;
+    sliderBackend = sb;
+    return true;
 }
 
 
-// --- Simple piece attacks ---
-void initialiseKnightAttacks() {
+// === Magic and PEXT slider tables ===
+// Magic numbers for fancy magic bitboards, indexed by square. Found offline
+// by a seeded random search for sparse numbers; any valid set would do.
+constexpr std::array<Bitboard, NUM_SQUARES> BISHOP_MAGIC_NUMBERS {
+    0x10102002004a1420ULL, 0x8020040400584008ULL, 0x10510800811201c8ULL,
+    0x5204042080000088ULL, 0x2204106880000002ULL, 0x1401042004000000ULL,
+    0x0400880410042004ULL, 0x0028208200a02020ULL, 0x1500241990010e00ULL,
+    0x8001200182020a40ULL, 0x40004101030b0000ULL, 0x8002041042000100ULL,
+    0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020a00ULL,
+    0x8000088400880520ULL, 0x0405004010040100ULL, 0x1005823210040108ULL,
+    0x2708008102040011ULL, 0x4048200404009100ULL, 0x0018104101400024ULL,
+    0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+    0x0006e080100c3040ULL, 0x0501044a11041800ULL, 0x9020300008004045ULL,
+    0x0894080000220040ULL, 0x1001010083104000ULL, 0x5004030040900080ULL,
+    0x000400422c012400ULL, 0x0002128698404812ULL, 0x1010108404900440ULL,
+    0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+    0xa010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL,
+    0x802a02020000b098ULL, 0x0009015090004060ULL, 0x4000821082081001ULL,
+    0x0100210040420800ULL, 0x0800004010488a00ULL, 0x2000081104004040ULL,
+    0x4c8e029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+    0x0000822802400008ULL, 0x00008a0101600000ULL, 0x3040003412080021ULL,
+    0x3040290220884800ULL, 0x4a1500401041004aULL, 0x8010200282020781ULL,
+    0x0020203142209091ULL, 0x0070300600902110ULL, 0x0040808800b62048ULL,
+    0x0000810400c44420ULL, 0x00080400440c0441ULL, 0x8340080020840411ULL,
+    0x0000000104208200ULL, 0x0000800810d00080ULL, 0x0400530411080200ULL,
+    0x4040702400932244ULL
+};
+constexpr std::array<Bitboard, NUM_SQUARES> ROOK_MAGIC_NUMBERS {
+    0x1080004008801020ULL, 0x0840092002c03000ULL, 0x1900200010400900ULL,
+    0x0880100008000480ULL, 0x4200100420080200ULL, 0x8100020100080400ULL,
+    0x0200040110886200ULL, 0x0200008040220411ULL, 0x0404800084400220ULL,
+    0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000a001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL,
+    0x0442000102105084ULL, 0x9080010020804100ULL, 0x0040404000201009ULL,
+    0x0000808010002009ULL, 0x2200090021d00100ULL, 0x0008008008040080ULL,
+    0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000a0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL,
+    0x1000100080080080ULL, 0x0442000a00049020ULL, 0x2100040080020080ULL,
+    0x0800120400900148ULL, 0x0010040a00128541ULL, 0x2800804000800030ULL,
+    0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xc100020080800400ULL, 0x0002000802000401ULL,
+    0x0182085882000401ULL, 0x0220204000808000ULL, 0x2860100040024022ULL,
+    0x0001002004110040ULL, 0x99101042000a0020ULL, 0x0004080004008080ULL,
+    0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040a00300ULL,
+    0x0801100280080480ULL, 0x0242009008200600ULL, 0x1002000489500200ULL,
+    0x0040800200010080ULL, 0x0091800041000080ULL, 0x0000209300488001ULL,
+    0x04c1002414824001ULL, 0x020020000b001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084c0007ULL, 0x0888221800813004ULL,
+    0x4000002840840112ULL
+};
+
+constexpr std::array<SliderMagic, NUM_SQUARES> makeSliderMagics(bool isRook) {
+    // Edge squares never block further movement, so are left out of the
+    // masks; but a rook on an edge still slides along it.
+    std::array<SliderMagic, NUM_SQUARES> magics {};
+    unsigned offset {0};
+    const Bitboard bbEdges {BB_A | BB_H | BB_1 | BB_8};
     for (int isq = 0; isq < NUM_SQUARES; ++isq) {
-        Bitboard bb {bbFromSq(square(isq))};
-        bb = ( shiftN(shiftNW(bb)) | shiftN(shiftNE(bb)) |
-               shiftE(shiftNE(bb)) | shiftE(shiftSE(bb)) |
-               shiftS(shiftSE(bb)) | shiftS(shiftSW(bb)) |
-               shiftW(shiftSW(bb)) | shiftW(shiftNW(bb)) );
-        knightAttacks[isq] = bb;
+        Square sq {square(isq)};
+        SliderMagic& m {magics[sq]};
+        if (isRook) {
+            m.mask = (findRankAttacks(sq, BB_NONE) & ~(BB_A | BB_H)) |
+                     (findFileAttacks(sq, BB_NONE) & ~(BB_1 | BB_8));
+            m.magic = ROOK_MAGIC_NUMBERS[sq];
+        } else {
+            m.mask = bishopAttacksKindergarten(sq, BB_NONE) & ~bbEdges;
+            m.magic = BISHOP_MAGIC_NUMBERS[sq];
+        }
+        m.shift = 64 - __builtin_popcountll(m.mask);
+        m.offset = offset;
+        offset += 1U << (64 - m.shift);
     }
-    return;
+    return magics;
 }
 
-
-void initialiseKingAttacks() {
-    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
-        Bitboard bb {bbFromSq(square(isq))};
-        bb = ( shiftN(bb) | shiftNE(bb) | shiftE(bb) | shiftSE(bb) |
-               shiftS(bb) | shiftSW(bb) | shiftW(bb) | shiftNW(bb) );
-        kingAttacks[isq] = bb;
+template <int tableSize>
+constexpr std::array<Bitboard, tableSize>
+makeSliderTable(const std::array<SliderMagic, NUM_SQUARES>& magics,
+                bool isRook, bool isPext) {
+    // For each square, enumerates every subset of the relevant occupancy mask
+    // (Carry-Rippler trick) and stores the kindergarten attacks for it.
+    // The enumeration order is that of the PEXT index, so the PEXT table is
+    // filled in order; the magic table is filled at the magic index.
+    std::array<Bitboard, tableSize> table {};
+    for (const SliderMagic& m : magics) {
+        const Square sq {square(&m - magics.data())};
+        unsigned idx {m.offset};
+        Bitboard bbOcc {BB_NONE};
+        do {
+            Bitboard bbAttacks {isRook ? rookAttacksKindergarten(sq, bbOcc)
+                                       : bishopAttacksKindergarten(sq, bbOcc)};
+            if (isPext) {
+                table[idx++] = bbAttacks;
+            } else {
+                table[m.offset + ((bbOcc * m.magic) >> m.shift)] = bbAttacks;
+            }
+            bbOcc = (bbOcc - m.mask) & m.mask;
+        } while (bbOcc);
     }
-    return;
+    return table;
 }
 
-
-void initialisePawnAttacks() {
-    // Will generate legal moves for illegal pawn positions too (1st/8th rank)
-    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
-        Bitboard bb {bbFromSq(square(isq))};
-        pawnAttacks[WHITE][isq] = shiftNE(bb) | shiftNW(bb);
-        pawnAttacks[BLACK][isq] = shiftSE(bb) | shiftSW(bb);
-    }
-    return;
-}
+constexpr std::array<SliderMagic, NUM_SQUARES> bishopMagics {
+    makeSliderMagics(false)
+};
+constexpr std::array<SliderMagic, NUM_SQUARES> rookMagics {
+    makeSliderMagics(true)
+};
+constexpr std::array<Bitboard, BISHOP_TABLE_SIZE> bishopMagicAttacks {
+    makeSliderTable<BISHOP_TABLE_SIZE>(bishopMagics, false, false)
+};
+constexpr std::array<Bitboard, ROOK_TABLE_SIZE> rookMagicAttacks {
+    makeSliderTable<ROOK_TABLE_SIZE>(rookMagics, true, false)
+};
+constexpr std::array<Bitboard, BISHOP_TABLE_SIZE> bishopPextAttacks {
+    makeSliderTable<BISHOP_TABLE_SIZE>(bishopMagics, false, true)
+};
+constexpr std::array<Bitboard, ROOK_TABLE_SIZE> rookPextAttacks {
+    makeSliderTable<ROOK_TABLE_SIZE>(rookMagics, true, true)
+};
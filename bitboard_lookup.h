@@ -6,34 +6,370 @@
 
 #include <array>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PEXT_COMPILABLE // PEXT backend can be compiled (BMI2 target attribute)
+#endif
+
 // === bitboard_lookup.h ===
-// Contains Bitboard lookup tables (for move generation) and functions to
-// generate them.
-// Also contains functions to get slider attacks in particular directions.
+// Contains Bitboard lookup tables (for move generation) and the constexpr
+// functions that generate them. Every table is built at compile time into
+// read-only data, so there is nothing to initialise before a lookup, tables
+// can be shared between threads freely, and lookups on a known square can be
+// constant-folded by the compiler.
+// Also contains functions to get slider attacks in particular directions, and
+// whole bishop/rook attacks through one of several backends (see below).
+
+
+// === Table generators ===
+// Run at compile time only, to define the lookup tables further down.
+
+// --- Simple piece attacks ---
+constexpr std::array<Bitboard, NUM_SQUARES> makeKnightAttacks() {
+    std::array<Bitboard, NUM_SQUARES> attacks {};
+    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+        Bitboard bb {bbFromSq(square(isq))};
+        bb = ( shiftN(shiftNW(bb)) | shiftN(shiftNE(bb)) |
+               shiftE(shiftNE(bb)) | shiftE(shiftSE(bb)) |
+               shiftS(shiftSE(bb)) | shiftS(shiftSW(bb)) |
+               shiftW(shiftSW(bb)) | shiftW(shiftNW(bb)) );
+        attacks[isq] = bb;
+    }
+    return attacks;
+}
+
+constexpr std::array<Bitboard, NUM_SQUARES> makeKingAttacks() {
+    std::array<Bitboard, NUM_SQUARES> attacks {};
+    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+        Bitboard bb {bbFromSq(square(isq))};
+        bb = ( shiftN(bb) | shiftNE(bb) | shiftE(bb) | shiftSE(bb) |
+               shiftS(bb) | shiftSW(bb) | shiftW(bb) | shiftNW(bb) );
+        attacks[isq] = bb;
+    }
+    return attacks;
+}
+
+constexpr std::array<std::array<Bitboard, NUM_SQUARES>, NUM_COLOURS>
+makePawnAttacks() {
+    // Will generate legal moves for illegal pawn positions too (1st/8th rank)
+    std::array<std::array<Bitboard, NUM_SQUARES>, NUM_COLOURS> attacks {};
+    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+        Bitboard bb {bbFromSq(square(isq))};
+        attacks[WHITE][isq] = shiftNE(bb) | shiftNW(bb);
+        attacks[BLACK][isq] = shiftSE(bb) | shiftSW(bb);
+    }
+    return attacks;
+}
+
+// --- diagonal masks ---
+constexpr std::array<Bitboard, NUM_SQUARES> makeDiagMasks(bool isAnti) {
+    // Generates diagMasks (or antidiagMasks, if isAnti), indexed by Square.
+    // first define the S and W (anti: S and E) edges of the table
+    std::array<Bitboard, NUM_SQUARES> diag {};
+    std::array<Bitboard, NUM_SQUARES> antidiag {};
+    diag[0] = BB_LONG_DIAG;
+    antidiag[7] = BB_LONG_ANTIDIAG;
+    antidiag[56] = BB_LONG_ANTIDIAG;
+    
+    for (int i = 1; i < 8; ++i) {
+        diag[i] = shiftS(diag[i - 1]);
+        diag[8*i] = shiftN(diag[8*i - 8]);
+        antidiag[7 - i] = shiftS(antidiag[8 - i]);
+        antidiag[7 + 8*i] = shiftN(antidiag[8*i - 1]);
+    }
+    // then propagate and fill in the rest of the table.    
+    for (int x = 1; x < 8; ++x) {
+        for (int y = 1; y < 8; ++y) {
+            diag[x+8*y] = diag[(x-1) + 8*(y-1)];
+            antidiag[7-x+8*y] = antidiag[(8-x) + 8*(y-1)];
+        }
+    }
+    return isAnti ? antidiag : diag;
+}
 
-// Initialise tables. Must be called at least once before doing any lookup.
-void initialiseBbLookup();
+// --- 1st-rank and 1st-file attacks ---
+constexpr std::array<std::array<Bitboard, 64>, 8> makeFirstRankAttacks() {
+    std::array<std::array<Bitboard, 64>, 8> attacks {};
+    for (int ioc = 0; ioc < 64; ++ioc) {
+         // +129 sets the end bits of rank to 1 (cannot attack past board edge)
+        Bitboard oc = (ioc << 1) + 129;
+        
+        // If slider at end of rank, that end must be handled differently.
+        // Therefore use two separate if conditions to isolate them.
+        for (int idx_r = 0; idx_r < 8; ++idx_r) {
+            int smallLimit {0}; // Westmost square attacked by the slider.
+            int bigLimit {7}; // Eastmost square attacked by the slider.
+            Bitboard r {bbFromSq(square(idx_r))};
+            if (idx_r != 0) {
+                // zero high bits, take highest set bit (lowest above slider).
+                smallLimit = gsb(oc & (r - 1));
+            } 
+            if (idx_r != 7) {
+                // zero low bits, take lowest set bit (highest below slider).
+                bigLimit = lsb(oc & ~((r << 1) - 1));
+            }
+            // Get bitboard of all bits between limits, inclusive.
+            Bitboard bb = ((bbFromSq(square(bigLimit)) << 1) -
+                           bbFromSq(square(smallLimit)));
+            bb ^= r; // slider does not attack itself
+            bb *= BB_A; // north-fill multiplication
+            attacks[idx_r][ioc] = bb;
+        }
+    }
+    return attacks;
+}
 
-// Getters: Return a Bitboard for slider attacks, given a Square sq and an
-// occupancy Bitboard bbPos.
-Bitboard findRankAttacks(Square sq, Bitboard bbPos);
-Bitboard findDiagAttacks(Square sq, Bitboard bbPos);
-Bitboard findAntidiagAttacks(Square sq, Bitboard bbPos);
-Bitboard findFileAttacks(Square sq, Bitboard bbPos);
+constexpr std::array<std::array<Bitboard, 64>, 8> makeFirstFileAttacks() {
+    std::array<std::array<Bitboard, 64>, 8> attacks {};
+    for (int ioc = 0; ioc < 64; ++ioc) {
+        // NOTE: Index 0 here is 8th rank of the real file!
+        // In first-rank terms, 1st rank is mapped to h1, 2nd rank to g1, etc.
+        // First we generate the attacks using a rank, taking into account the
+        // changed indices, then flip it later such that it is correct.
+        
+        // +129 sets the end bits of rank to 1 (cannot attack past board edge)
+        Bitboard oc = (ioc << 1) + 129;
+        
+        // If slider at end of rank, that end must be handled differently.
+        // Therefore use two separate if conditions to isolate them.
+        for (int idx_r = 0; idx_r < 8; ++idx_r) {
+            int smallLimit {0};
+            int bigLimit {7};
+            Bitboard r {bbFromSq(square(7 - idx_r))};
+            if (idx_r != 7) {
+                // zero high bits, take highest set bit (lowest above slider).
+                smallLimit = gsb(oc & (r - 1));
+            } 
+            if (idx_r != 0) {
+                // zero low bits, take lowest set bit (highest below slider).
+                bigLimit = lsb(oc & ~((r << 1) - 1));
+            }
+            // Get bitboard of all bits between limits, inclusive.
+            Bitboard bb = ((bbFromSq(square(bigLimit)) << 1) -
+                           bbFromSq(square(smallLimit)));
+            bb ^= r; // slider does not attack itself
+            bb = (bb * BB_LONG_DIAG) & BB_H; // rotate attacks to the h-file.
+            // Now fill left.
+            bb |= bb >> 1;
+            bb |= bb >> 2;
+            bb |= bb >> 4;
+            attacks[idx_r][ioc] = bb;
+        }
+    }
+    return attacks;
+}
 
 
 // === Lookup tables ===
-// Declared here, defined in the cpp. Must be generated before doing any lookup.
 
 // Indexed by square on the chessboard.
-extern std::array<Bitboard, NUM_SQUARES> knightAttacks;
-extern std::array<Bitboard, NUM_SQUARES> kingAttacks;
+inline constexpr std::array<Bitboard, NUM_SQUARES> knightAttacks {
+    makeKnightAttacks()
+};
+inline constexpr std::array<Bitboard, NUM_SQUARES> kingAttacks {
+    makeKingAttacks()
+};
 // Pawn attacks depend on colour, so indexed by square then colour.
-extern std::array<std::array<Bitboard, NUM_SQUARES>, NUM_COLOURS> pawnAttacks;
+inline constexpr std::array<std::array<Bitboard, NUM_SQUARES>, NUM_COLOURS>
+pawnAttacks {makePawnAttacks()};
 
 // Indexed by square on the chessboard. Contains the Bitboard of the
 // corresponding (anti)diagonal passing through that square.
-extern std::array<Bitboard, NUM_SQUARES> diagMasks;
-extern std::array<Bitboard, NUM_SQUARES> antidiagMasks;
+inline constexpr std::array<Bitboard, NUM_SQUARES> diagMasks {
+    makeDiagMasks(false)
+};
+inline constexpr std::array<Bitboard, NUM_SQUARES> antidiagMasks {
+    makeDiagMasks(true)
+};
+
+// Arrays of first-rank/file attacks, for slider move generation.
+// Indexed by the 8 possible slider locations, and 2^(8 - 2) = 64 non-edge
+// occupancy states.
+inline constexpr std::array<std::array<Bitboard, 64>, 8> firstRankAttacks {
+    makeFirstRankAttacks()
+};
+inline constexpr std::array<std::array<Bitboard, 64>, 8> firstFileAttacks {
+    makeFirstFileAttacks()
+};
+
+
+// === Sliding attack getters ===
+// Return a Bitboard for slider attacks, given a Square sq and an occupancy
+// Bitboard bbPos (containing all pieces of the position).
+constexpr Bitboard findRankAttacks(Square sq, Bitboard bbPos) {
+    int irank {getRankIdx(sq)};
+    int ifile {getFileIdx(sq)};
+    Bitboard oc { bbPos & (BB_1 << (8*irank)) }; // extract just desired rank
+    // b-file multiplication puts desired bits on 8th rank to extract.
+    int ioc { static_cast<int>((oc * BB_B) >> (64 - 6)) };
+    return (BB_1 << (8*irank)) & firstRankAttacks[ifile][ioc];
+}
+
+constexpr Bitboard findDiagAttacks(Square sq, Bitboard bbPos) {
+    int ifile {getFileIdx(sq)};
+    Bitboard oc { bbPos & (diagMasks[sq]) }; // extract just desired diagonal
+    // b-file multiplication puts desired bits on 8th rank.
+    int ioc = { static_cast<int>((oc * BB_B) >> (64 - 6)) };
+    return diagMasks[sq] & firstRankAttacks[ifile][ioc];
+}
+
+constexpr Bitboard findAntidiagAttacks(Square sq, Bitboard bbPos) {
+    int ifile {getFileIdx(sq)};
+    Bitboard oc { bbPos & (antidiagMasks[sq]) };
+    // b-file multiplication puts desired bits on 8th rank.
+    int ioc = { static_cast<int>((oc * BB_B) >> (64-6)) };
+    return antidiagMasks[sq] & firstRankAttacks[ifile][ioc];
+}
+
+constexpr Bitboard findFileAttacks(Square sq, Bitboard bbPos) {
+    int irank {getRankIdx(sq)};
+    int ifile {getFileIdx(sq)};
+    Bitboard oc { (bbPos >> ifile) & BB_A }; // send desired file bits to a-file
+    // multiply by c2-h7 diagonal; flip multiplication extracts lookup index
+    int ioc { static_cast<int>(oc * 0x0080402010080400ULL >> (64-6)) };
+    return firstFileAttacks[irank][ioc] & (BB_A << ifile);
+}
+
+
+// === Lines and segments between squares ===
+constexpr std::array<std::array<Bitboard, NUM_SQUARES>, NUM_SQUARES>
+makeLineMasks(bool isBetween) {
+    // For each pair of squares on a common line, slide from each square
+    // towards the other (on an otherwise empty board) to find the line, and
+    // with the other square as the only blocker to find the segment between.
+    std::array<std::array<Bitboard, NUM_SQUARES>, NUM_SQUARES> masks {};
+    Bitboard (*const lineGetters[4])(Square, Bitboard) {
+        findRankAttacks, findFileAttacks, findDiagAttacks, findAntidiagAttacks
+    };
+    for (int isq1 = 0; isq1 < NUM_SQUARES; ++isq1) {
+        Square sq1 {square(isq1)};
+        for (int isq2 = 0; isq2 < NUM_SQUARES; ++isq2) {
+            Square sq2 {square(isq2)};
+            Bitboard bbBoth {sq1 | sq2};
+            for (auto findAttacks : lineGetters) {
+                if (!(findAttacks(sq1, BB_NONE) & sq2)) {
+                    continue;
+                }
+                masks[sq1][sq2] = isBetween
+                    ? findAttacks(sq1, bbBoth) & findAttacks(sq2, bbBoth)
+                    : (findAttacks(sq1, BB_NONE) & findAttacks(sq2, BB_NONE))
+                      | bbBoth;
+            }
+        }
+    }
+    return masks;
+}
+
+// Indexed by two squares. If the squares share a rank, file or (anti)diagonal,
+// betweenMasks contains the squares strictly between them and lineMasks the
+// whole line through both of them. Otherwise both are empty.
+inline constexpr std::array<std::array<Bitboard, NUM_SQUARES>, NUM_SQUARES>
+betweenMasks {makeLineMasks(true)};
+inline constexpr std::array<std::array<Bitboard, NUM_SQUARES>, NUM_SQUARES>
+lineMasks {makeLineMasks(false)};
+
+
+// === Slider attack backends ===
+// Whole bishop and rook attacks can be looked up in several ways:
+// - KINDERGARTEN: combining the rank/file/(anti)diagonal getters above.
+// - MAGIC: "fancy" magic bitboards; one multiply and one lookup per slider.
+// - PEXT: as MAGIC, but indexed by the BMI2 PEXT instruction (x86 only).
+//   Slow on AMD processors before Zen 3, where PEXT is microcoded.
+// The backend can be fixed at build time by defining SLIDER_BACKEND (e.g.
+// -DSLIDER_BACKEND=PEXT -mbmi2). Otherwise one is picked from the CPU's
+// features at startup, and setSliderBackend() can change it.
+// KINDERGARTEN is always available, and is the fallback. It is also what is
+// used if a lookup happens during static initialisation, before the pick.
+enum SliderBackend : int {KINDERGARTEN, MAGIC, PEXT};
+
+bool isSliderBackendSupported(SliderBackend sb);
+SliderBackend detectSliderBackend();
+bool setSliderBackend(SliderBackend sb); // false (and no change) if unsupported
+
+// Per-square information for the MAGIC and PEXT backends. Both backends use
+// the same masks and table offsets, with differently ordered tables.
+struct SliderMagic {
+    Bitboard mask {BB_NONE}; // relevant occupancy (edges excluded)
+    Bitboard magic {BB_NONE};
+    unsigned offset {0}; // start of this square's entries in the table
+    int shift {0};
+};
+// Table sizes: sum over squares of 2^(number of bits in mask).
+constexpr int BISHOP_TABLE_SIZE {5248};
+constexpr int ROOK_TABLE_SIZE {102400};
+
+// The tables are large, so are generated (at compile time) only in the cpp.
+extern SliderBackend sliderBackend;
+extern const std::array<SliderMagic, NUM_SQUARES> bishopMagics;
+extern const std::array<SliderMagic, NUM_SQUARES> rookMagics;
+extern const std::array<Bitboard, BISHOP_TABLE_SIZE> bishopMagicAttacks;
+extern const std::array<Bitboard, ROOK_TABLE_SIZE> rookMagicAttacks;
+extern const std::array<Bitboard, BISHOP_TABLE_SIZE> bishopPextAttacks;
+extern const std::array<Bitboard, ROOK_TABLE_SIZE> rookPextAttacks;
+
+// --- Backend-specific getters ---
+constexpr Bitboard bishopAttacksKindergarten(Square sq, Bitboard bbPos) {
+    return findDiagAttacks(sq, bbPos) | findAntidiagAttacks(sq, bbPos);
+}
+constexpr Bitboard rookAttacksKindergarten(Square sq, Bitboard bbPos) {
+    return findRankAttacks(sq, bbPos) | findFileAttacks(sq, bbPos);
+}
+
+inline Bitboard bishopAttacksMagic(Square sq, Bitboard bbPos) {
+    const SliderMagic& m {bishopMagics[sq]};
+    return bishopMagicAttacks[m.offset + (((bbPos & m.mask) * m.magic) >> m.shift)];
+}
+inline Bitboard rookAttacksMagic(Square sq, Bitboard bbPos) {
+    const SliderMagic& m {rookMagics[sq]};
+    return rookMagicAttacks[m.offset + (((bbPos & m.mask) * m.magic) >> m.shift)];
+}
+
+#ifdef PEXT_COMPILABLE
+__attribute__((target("bmi2")))
+inline Bitboard bishopAttacksPext(Square sq, Bitboard bbPos) {
+    const SliderMagic& m {bishopMagics[sq]};
+    return bishopPextAttacks[m.offset + _pext_u64(bbPos, m.mask)];
+}
+__attribute__((target("bmi2")))
+inline Bitboard rookAttacksPext(Square sq, Bitboard bbPos) {
+    const SliderMagic& m {rookMagics[sq]};
+    return rookPextAttacks[m.offset + _pext_u64(bbPos, m.mask)];
+}
+#else
+// Never selected (unsupported), but keeps the dispatch below compiling.
+inline Bitboard bishopAttacksPext(Square sq, Bitboard bbPos) {
+    return bishopAttacksMagic(sq, bbPos);
+}
+inline Bitboard rookAttacksPext(Square sq, Bitboard bbPos) {
+    return rookAttacksMagic(sq, bbPos);
+}
+#endif //#ifdef PEXT_COMPILABLE
+
+// --- Unified getters ---
+inline SliderBackend getSliderBackend() {
+#ifdef SLIDER_BACKEND
+    return SLIDER_BACKEND; // constant, so the dispatch is compiled away.
+#else
+    return sliderBackend;
+#endif
+}
+
+inline Bitboard bishopAttacks(Square sq, Bitboard bbPos) {
+    switch (getSliderBackend()) {
+    case MAGIC: return bishopAttacksMagic(sq, bbPos);
+    case PEXT: return bishopAttacksPext(sq, bbPos);
+    default: return bishopAttacksKindergarten(sq, bbPos);
+    }
+}
+inline Bitboard rookAttacks(Square sq, Bitboard bbPos) {
+    switch (getSliderBackend()) {
+    case MAGIC: return rookAttacksMagic(sq, bbPos);
+    case PEXT: return rookAttacksPext(sq, bbPos);
+    default: return rookAttacksKindergarten(sq, bbPos);
+    }
+}
+inline Bitboard queenAttacks(Square sq, Bitboard bbPos) {
+    return bishopAttacks(sq, bbPos) | rookAttacks(sq, bbPos);
+}
 
 #endif //#ifndef BITBOARD_LOOKUP_INCLUDED
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "check_batch.h"
+
+#include "chess_types.h"
+#include "bitboard.h"
+#include "position.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_CHECK_COMPILABLE // AVX kernels can be compiled (target attributes)
+#endif
+
+// === CheckBatch ===
+void CheckBatch::add(const Position& pos, Colour co) {
+    const Colour coEnemy {!co};
+    const Bitboard bbQueens {pos.getUnitsBb(coEnemy, QUEEN)};
+    bbKing.push_back(pos.getUnitsBb(co, KING));
+    bbAll.push_back(pos.getUnitsBb());
+    bbIsBlack.push_back(co == BLACK ? BB_ALL : BB_NONE);
+    bbPawns.push_back(pos.getUnitsBb(coEnemy, PAWN));
+    bbKnights.push_back(pos.getUnitsBb(coEnemy, KNIGHT));
+    bbDiagSliders.push_back(pos.getUnitsBb(coEnemy, BISHOP) | bbQueens);
+    bbOrthoSliders.push_back(pos.getUnitsBb(coEnemy, ROOK) | bbQueens);
+    bbKings.push_back(pos.getUnitsBb(coEnemy, KING));
+    return;
+}
+
+void CheckBatch::clear() {
+    for (std::vector<Bitboard>* bbs : {&bbKing, &bbAll, &bbIsBlack, &bbPawns,
+                                       &bbKnights, &bbDiagSliders,
+                                       &bbOrthoSliders, &bbKings}) {
+        bbs->clear();
+    }
+    return;
+}
+
+
+// === Kernel selection ===
+bool isCheckKernelSupported(CheckKernel ck) {
+    switch (ck) {
+    case CHECK_SCALAR: return true;
+    case CHECK_AVX2:
+    case CHECK_AVX512:
+#ifdef SIMD_CHECK_COMPILABLE
+        __builtin_cpu_init(); // may run before libgcc's own constructor does
+        return ck == CHECK_AVX2 ? __builtin_cpu_supports("avx2")
+                                : __builtin_cpu_supports("avx512f");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+CheckKernel detectCheckKernel() {
+    // Prefers the widest kernel.
+    if (isCheckKernelSupported(CHECK_AVX512)) {return CHECK_AVX512;}
+    if (isCheckKernelSupported(CHECK_AVX2)) {return CHECK_AVX2;}
+    return CHECK_SCALAR;
+}
+
+static CheckKernel checkKernel {detectCheckKernel()};
+
+bool setCheckKernel(CheckKernel ck) {
+    if (!isCheckKernelSupported(ck)) {
+        return false;
+    }
+    checkKernel = ck;
+    return true;
+}
+
+CheckKernel getCheckKernel() {
+    return checkKernel;
+}
+
+
+// === Kernel body ===
+// Written once, for V either a Bitboard or a GCC vector of Bitboards: the
+// operators work lane by lane, with scalars broadcast to every lane. Forced
+// inline, so that it is compiled for the instruction set of each caller (and
+// no call passes a vector, so GCC's warnings that the ABI for passing them
+// differs between instruction sets don't apply).
+#define CHECK_INLINE inline __attribute__((always_inline))
+#pragma GCC diagnostic ignored "-Wpsabi" // (to the end of the file)
+
+template <int shift, typename V>
+CHECK_INLINE V shiftBy(const V& bb) {
+    if constexpr (shift > 0) {
+        return bb << shift;
+    } else {
+        return bb >> -shift;
+    }
+}
+
+template <int shift, Bitboard bbNoWrap, typename V>
+CHECK_INLINE V slideAttacks(const V& bbFrom, const V& bbEmpty) {
+    // Attacks from bbFrom in one direction, through empty squares (Kogge-Stone
+    // fill). bbNoWrap excludes the squares that a shift in this direction
+    // wraps onto from the other edge.
+    V bbGen {bbFrom};
+    V bbPro {bbEmpty & bbNoWrap};
+    bbGen |= bbPro & shiftBy<shift>(bbGen);
+    bbPro &= shiftBy<shift>(bbPro);
+    bbGen |= bbPro & shiftBy<2 * shift>(bbGen);
+    bbPro &= shiftBy<2 * shift>(bbPro);
+    bbGen |= bbPro & shiftBy<4 * shift>(bbGen);
+    return shiftBy<shift>(bbGen) & bbNoWrap;
+}
+
+template <typename V>
+CHECK_INLINE V load(const std::vector<Bitboard>& bbs, size_t i) {
+    V bb;
+    std::memcpy(&bb, bbs.data() + i, sizeof(V));
+    return bb;
+}
+
+template <typename V>
+CHECK_INLINE void findCheckersAt(const CheckBatch& batch, size_t i,
+                                 Bitboard* bbCheckers) {
+    // Entries i onwards, as many as V has lanes.
+    constexpr Bitboard NOT_A {~BB_A};
+    constexpr Bitboard NOT_H {~BB_H};
+    constexpr Bitboard NOT_AB {~(BB_A | BB_B)};
+    constexpr Bitboard NOT_GH {~(BB_G | BB_H)};
+    const V bbKing {load<V>(batch.bbKing, i)};
+    const V bbEmpty {~load<V>(batch.bbAll, i)};
+    const V bbIsBlack {load<V>(batch.bbIsBlack, i)};
+    
+    const V bbDiag {slideAttacks<9, NOT_A>(bbKing, bbEmpty) |
+                    slideAttacks<7, NOT_H>(bbKing, bbEmpty) |
+                    slideAttacks<-7, NOT_A>(bbKing, bbEmpty) |
+                    slideAttacks<-9, NOT_H>(bbKing, bbEmpty)};
+    const V bbOrtho {slideAttacks<8, BB_ALL>(bbKing, bbEmpty) |
+                     slideAttacks<-8, BB_ALL>(bbKing, bbEmpty) |
+                     slideAttacks<1, NOT_A>(bbKing, bbEmpty) |
+                     slideAttacks<-1, NOT_H>(bbKing, bbEmpty)};
+    const V bbKnight {((bbKing << 17 | bbKing >> 15) & NOT_A) |
+                      ((bbKing << 15 | bbKing >> 17) & NOT_H) |
+                      ((bbKing << 10 | bbKing >> 6) & NOT_AB) |
+                      ((bbKing << 6 | bbKing >> 10) & NOT_GH)};
+    const V bbKingMoves {((bbKing << 9 | bbKing >> 7 | bbKing << 1) & NOT_A) |
+                         ((bbKing << 7 | bbKing >> 9 | bbKing >> 1) & NOT_H) |
+                         bbKing << 8 | bbKing >> 8};
+    // A white king is attacked by pawns in front of it, a black one behind.
+    const V bbPawnUp {((bbKing << 9) & NOT_A) | ((bbKing << 7) & NOT_H)};
+    const V bbPawnDown {((bbKing >> 7) & NOT_A) | ((bbKing >> 9) & NOT_H)};
+    const V bbPawn {(bbPawnUp & ~bbIsBlack) | (bbPawnDown & bbIsBlack)};
+    
+    const V bbResult {(bbDiag & load<V>(batch.bbDiagSliders, i)) |
+                      (bbOrtho & load<V>(batch.bbOrthoSliders, i)) |
+                      (bbKnight & load<V>(batch.bbKnights, i)) |
+                      (bbKingMoves & load<V>(batch.bbKings, i)) |
+                      (bbPawn & load<V>(batch.bbPawns, i))};
+    std::memcpy(bbCheckers + i, &bbResult, sizeof(V));
+    return;
+}
+
+
+// === Kernels ===
+// Each vector kernel does whole vectors only, and returns where it stopped;
+// the scalar kernel does the rest.
+static void findCheckersScalar(const CheckBatch& batch, size_t iFirst,
+                               Bitboard* bbCheckers) {
+    for (size_t i = iFirst; i < batch.size(); ++i) {
+        findCheckersAt<Bitboard>(batch, i, bbCheckers);
+    }
+    return;
+}
+
+#ifdef SIMD_CHECK_COMPILABLE
+typedef Bitboard Bitboard4 __attribute__((vector_size(4 * sizeof(Bitboard))));
+typedef Bitboard Bitboard8 __attribute__((vector_size(8 * sizeof(Bitboard))));
+
+__attribute__((target("avx2")))
+static size_t findCheckersAvx2(const CheckBatch& batch, Bitboard* bbCheckers) {
+    const size_t iEnd {batch.size() - batch.size() % 4};
+    for (size_t i = 0; i < iEnd; i += 4) {
+        findCheckersAt<Bitboard4>(batch, i, bbCheckers);
+    }
+    return iEnd;
+}
+
+__attribute__((target("avx512f")))
+static size_t findCheckersAvx512(const CheckBatch& batch,
+                                 Bitboard* bbCheckers) {
+    const size_t iEnd {batch.size() - batch.size() % 8};
+    for (size_t i = 0; i < iEnd; i += 8) {
+        findCheckersAt<Bitboard8>(batch, i, bbCheckers);
+    }
+    return iEnd;
+}
+#endif //#ifdef SIMD_CHECK_COMPILABLE
+
+void findCheckers(const CheckBatch& batch, Bitboard* bbCheckers) {
+    size_t iFirst {0};
+#ifdef SIMD_CHECK_COMPILABLE
+    switch (checkKernel) {
+    case CHECK_AVX2: iFirst = findCheckersAvx2(batch, bbCheckers); break;
+    case CHECK_AVX512: iFirst = findCheckersAvx512(batch, bbCheckers); break;
+    default: break;
+    }
+#endif
+    findCheckersScalar(batch, iFirst, bbCheckers);
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef CHECK_BATCH_INCLUDED
+#define CHECK_BATCH_INCLUDED
+
+#include "chess_types.h"
+#include "bitboard.h"
+
+#include <cstddef>
+#include <vector>
+
+// === check_batch.h ===
+// Finds the units checking a king for many positions at once, e.g. to screen
+// thousands of candidate positions for "is side X in check". SIMD kernels
+// handle 4 (AVX2) or 8 (AVX-512) positions per instruction. They use no
+// lookup tables: slider attacks are Kogge-Stone fills from the king through
+// empty squares, and the other attacks are shifts of the king, so every
+// position takes the same steps.
+
+class Position;
+
+// === CheckBatch ===
+// The bitboards the kernels need from each position, one array per bitboard
+// (so a kernel loads 4 or 8 positions' worth of each at once).
+struct CheckBatch {
+    std::vector<Bitboard> bbKing; // the king to test
+    std::vector<Bitboard> bbAll;
+    std::vector<Bitboard> bbIsBlack; // all ones if the king is black
+    // The other side's units. Queens count as both kinds of slider.
+    std::vector<Bitboard> bbPawns;
+    std::vector<Bitboard> bbKnights;
+    std::vector<Bitboard> bbDiagSliders;
+    std::vector<Bitboard> bbOrthoSliders;
+    std::vector<Bitboard> bbKings;
+    
+    // Adds the king of colour co in pos (which must have exactly one).
+    void add(const Position& pos, Colour co);
+    void clear();
+    size_t size() const {return bbKing.size();}
+};
+
+// === Kernels ===
+// SCALAR is always available, and is the fallback. One is picked from the
+// CPU's features at startup, and setCheckKernel() can change it. The pick is
+// made once per batch, so unlike the slider backends there is no build-time
+// option to fix it.
+enum CheckKernel : int {CHECK_SCALAR, CHECK_AVX2, CHECK_AVX512};
+
+bool isCheckKernelSupported(CheckKernel ck);
+CheckKernel detectCheckKernel();
+bool setCheckKernel(CheckKernel ck); // false (and no change) if unsupported
+CheckKernel getCheckKernel();
+
+// Sets bbCheckers[i] to the units checking the king of batch entry i (as
+// attacksTo would give them), so the king is in check if it is non-empty.
+void findCheckers(const CheckBatch& batch, Bitboard* bbCheckers);
+
+#endif //#ifndef CHECK_BATCH_INCLUDED
\ No newline at end of file
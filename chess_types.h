@@ -21,7 +21,7 @@ enum Colour : int {WHITE, BLACK, NO_COLOUR};
 constexpr int NUM_COLOURS {2};
 
 // Converts white to black and vice versa.
-inline Colour operator!(Colour co) {
+constexpr Colour operator!(Colour co) {
     return static_cast<Colour>(static_cast<int>(co) ^ 0x1);
 }
 
@@ -97,12 +97,12 @@ enum Square : int {
 };
 constexpr int NUM_SQUARES {64};
 
-inline Square square(int isq) {
+constexpr Square square(int isq) {
     if (SQ_A1 <= isq && isq <= NO_SQ) {return static_cast<Square>(isq);}
     else {throw std::range_error("Integer not a valid square(int isq).");}
 }
 
-inline Square square(int x, int y) {
+constexpr Square square(int x, int y) {
     //returns validated Square from x/y algebraic coords.
     if ((0 <= x && x <= 7) && (0 <= y && y <= 7)) {
         return static_cast<Square>(x + 8*y);
@@ -112,11 +112,11 @@ inline Square square(int x, int y) {
     }
 }
 
-inline int getRankIdx(Square sq) {return static_cast<int>(sq) / 8;}
-inline int getFileIdx(Square sq) {return static_cast<int>(sq) % 8;}
+constexpr int getRankIdx(Square sq) {return static_cast<int>(sq) / 8;}
+constexpr int getFileIdx(Square sq) {return static_cast<int>(sq) % 8;}
 
-inline Square shiftN(Square sq) {return square(static_cast<int>(sq) + 8);}
-inline Square shiftS(Square sq) {return square(static_cast<int>(sq) - 8);}
+constexpr Square shiftN(Square sq) {return square(static_cast<int>(sq) + 8);}
+constexpr Square shiftS(Square sq) {return square(static_cast<int>(sq) - 8);}
 
 
 // === CastlingRights ===
@@ -3,7 +3,10 @@
 
 #include "chess_types.h"
 
-#include <vector>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 // === move.h ===
@@ -24,7 +27,8 @@
 // the special flag is not set as promotion, then the bits can be repurposed.)
 
 typedef uint16_t Move;
-typedef std::vector<Move> Movelist; // in case needed
+// Not a move (a1 to a1); used where there is no move, e.g. no hash move.
+constexpr Move NULL_MOVE {0};
 
 // Enum of "special" flags for readability.
 enum MoveSpecial {
@@ -102,4 +106,63 @@ inline std::string toString(Move mv) {
 }
 
 
+// === Movelist ===
+// A fixed-capacity list of Moves, with a vector-like interface. It lives
+// wherever it is declared (usually the stack), so filling it never allocates.
+// No legal chess position has more than 218 moves, so MAX_MOVES is plenty;
+// appending past it is undefined (checked by assert only).
+constexpr int MAX_MOVES {256};
+
+class Movelist {
+    public:
+        // Deliberately leaves the array uninitialised.
+        Movelist() : sz {0} {}
+        
+        void push_back(Move mv) {
+            assert(sz < MAX_MOVES);
+            moves[sz++] = mv;
+        }
+        void pop_back() {--sz;}
+        void clear() {sz = 0;}
+        // Only shrinking is supported.
+        void resize(size_t n) {sz = n;}
+        Move* erase(Move* it) {
+            // Shifts the later moves down to keep the order.
+            for (Move* itNext = it + 1; itNext != end(); ++itNext) {
+                *(itNext - 1) = *itNext;
+            }
+            --sz;
+            return it;
+        }
+        
+        size_t size() const {return sz;}
+        bool empty() const {return sz == 0;}
+        Move& operator[](size_t i) {return moves[i];}
+        Move operator[](size_t i) const {return moves[i];}
+        Move back() const {return moves[sz - 1];}
+        
+        Move* begin() {return moves.data();}
+        Move* end() {return moves.data() + sz;}
+        const Move* begin() const {return moves.data();}
+        const Move* end() const {return moves.data() + sz;}
+    
+    private:
+        std::array<Move, MAX_MOVES> moves;
+        size_t sz;
+};
+
+// === ScoredMovelist ===
+// A Movelist whose moves can each carry an integer score (e.g. for move
+// ordering), so it can be filled by anything that fills a Movelist. Scores are
+// not initialised, nor kept in step by erase(); set them after generating.
+class ScoredMovelist : public Movelist {
+    public:
+        int getScore(size_t i) const {return scores[i];}
+        void setScore(size_t i, int score) {scores[i] = score;}
+    
+    private:
+        std::array<int, MAX_MOVES> scores;
+};
+
+
 #endif //#ifndef MOVE_INCLUDED
\ No newline at end of file
@@ -9,32 +9,126 @@
 #include <cstdint>
 #include <iostream>
 
+// Colour-templated generators (defined below), which the legal move generator
+// below dispatches to once per call, so their inner loops don't branch on it.
+template <Colour co>
+Movelist& addPawnMoves(Movelist& mvlist, const Position& pos, Bitboard bbTarget);
+template <Colour co>
+Movelist& addEpMoves(Movelist& mvlist, const Position& pos);
+template <Colour co>
+Movelist& addCastlingMoves(Movelist& mvlist, const Position& pos,
+                           Bitboard bbAttacked);
+
+
+template <Colour co, GenType gt>
 Movelist generateLegalMoves(Position& pos) {
-    Colour co {pos.getSideToMove()};
+    // Generates legal moves directly. The checkers and pinned units (cached in
+    // the Position) and the enemy attack map are used to restrict the targets
+    // of each unit. Only en passant captures are tested by making and
+    // unmaking the move (to catch discovered checks along the 4th/5th rank).
+    // The generation mode restricts the targets further, so moves outside it
+    // are never generated (rather than generated and filtered out).
     Movelist mvlist {};
-    // Start generating valid moves.
-    addKingMoves(mvlist, co, pos);
-    addKnightMoves(mvlist, co, pos);
-    addBishopMoves(mvlist, co, pos);
-    addRookMoves(mvlist, co, pos);
-    addQueenMoves(mvlist, co, pos);
-    addPawnMoves(mvlist, co, pos);
-    addEpMoves(mvlist, co, pos);
-    addCastlingMoves(mvlist, co, pos);
-    // Test for checks.
-    for (auto it = mvlist.begin(); it != mvlist.end();) {
-        if (isLegal(*it, pos)) {
-            ++it;
+    const Square ksq {lsb(pos.getUnitsBb(co, KING))};
+    const Bitboard bbCheckers {pos.getCheckers()};
+    if (gt == GEN_EVASIONS && !bbCheckers) {
+        return mvlist;
+    }
+    // Targets of the generation mode; pawns also promote in GEN_CAPTURES.
+    const Bitboard bbAll {pos.getUnitsBb()};
+    Bitboard bbModeTarget {BB_ALL};
+    Bitboard bbPawnTarget {BB_ALL};
+    if constexpr (gt == GEN_CAPTURES) {
+        bbModeTarget = pos.getUnitsBb(!co);
+        bbPawnTarget = bbModeTarget | (BB_OUR_8[co] & ~bbAll);
+    } else if constexpr (gt == GEN_QUIETS) {
+        bbModeTarget = ~bbAll;
+        bbPawnTarget = ~bbAll & ~BB_OUR_8[co];
+    }
+    // The king is removed from the occupancy, so that it cannot step back
+    // along the ray of a checking slider.
+    const Bitboard bbAttacked {attackMap(!co, bbAll ^ ksq, pos)};
+    addKingMoves(mvlist, co, pos, ~bbAttacked & bbModeTarget);
+    // In double check, only the king can move.
+    if (bbCheckers & (bbCheckers - 1)) {
+        return mvlist;
+    }
+    // In single check, other units must capture the checker or interpose.
+    Bitboard bbTarget {BB_ALL};
+    if (bbCheckers) {
+        bbTarget = bbCheckers | betweenMasks[ksq][lsb(bbCheckers)];
+    }
+    const size_t idxNonKing {mvlist.size()};
+    addKnightMoves(mvlist, co, pos, bbTarget & bbModeTarget);
+    addBishopMoves(mvlist, co, pos, bbTarget & bbModeTarget);
+    addRookMoves(mvlist, co, pos, bbTarget & bbModeTarget);
+    addQueenMoves(mvlist, co, pos, bbTarget & bbModeTarget);
+    addPawnMoves<co>(mvlist, pos, bbTarget & bbPawnTarget);
+    // Pinned units may only move along the line through them and their king.
+    const Bitboard bbPinned {pos.getPinned(co)};
+    if (bbPinned) {
+        size_t idxKeep {idxNonKing};
+        for (size_t i = idxNonKing; i < mvlist.size(); ++i) {
+            const Square fromSq {getFromSq(mvlist[i])};
+            if (!(bbPinned & fromSq) ||
+                (lineMasks[ksq][fromSq] & getToSq(mvlist[i]))) {
+                mvlist[idxKeep++] = mvlist[i];
+            }
+        }
+        mvlist.resize(idxKeep);
+    }
+    // Castling validity already includes the king's safety.
+    if constexpr (gt == GEN_QUIETS) {
+        if (!bbCheckers) {
+            addCastlingMoves<co>(mvlist, pos, bbAttacked);
+        }
+        return mvlist;
+    }
+    // En passant is rare enough to test by make/unmake (in isLegal).
+    const size_t idxEp {mvlist.size()};
+    addEpMoves<co>(mvlist, pos);
+    for (size_t i = idxEp; i < mvlist.size();) {
+        if (isLegal(mvlist[i], pos)) {
+            ++i;
         } else {
-            it = mvlist.erase(it);
+            mvlist.erase(mvlist.begin() + i);
         }
     }
+    if (gt == GEN_ALL && !bbCheckers) {
+        addCastlingMoves<co>(mvlist, pos, bbAttacked);
+    }
     return mvlist;
 }
 
 
+Movelist generateLegalMoves(Position& pos, GenType gt) {
+    // Dispatches once on the side to move and the mode, so that the choices
+    // depending on them are made at compile time inside the generator.
+    const bool isWhite {pos.getSideToMove() == WHITE};
+    switch (gt) {
+    case GEN_CAPTURES:
+        return isWhite ? generateLegalMoves<WHITE, GEN_CAPTURES>(pos)
+                       : generateLegalMoves<BLACK, GEN_CAPTURES>(pos);
+    case GEN_QUIETS:
+        return isWhite ? generateLegalMoves<WHITE, GEN_QUIETS>(pos)
+                       : generateLegalMoves<BLACK, GEN_QUIETS>(pos);
+    case GEN_EVASIONS:
+        return isWhite ? generateLegalMoves<WHITE, GEN_EVASIONS>(pos)
+                       : generateLegalMoves<BLACK, GEN_EVASIONS>(pos);
+    default:
+        return isWhite ? generateLegalMoves<WHITE, GEN_ALL>(pos)
+                       : generateLegalMoves<BLACK, GEN_ALL>(pos);
+    }
+}
+
+
 bool isInCheck(Colour co, const Position& pos) {
     // Test if a side (colour) is in check.
+    if (co == pos.getSideToMove()) {
+        if (const CheckInfo* ci = pos.findCheckInfo()) {
+            return ci->bbCheckers != BB_NONE;
+        }
+    }
     Bitboard bb {pos.getUnitsBb(co, KING)};
     Square sq {popLsb(bb)}; // assumes exactly one king per side.
     return isAttacked(sq, !co, pos);
@@ -43,45 +137,102 @@ bool isInCheck(Colour co, const Position& pos) {
 
 bool isLegal(Move mv, Position& pos) {
     // Test if making a move would leave one's own royalty in check.
-    // Assumes move is valid.
-    // For eventual speedup logic can be improved from naive make-unmake-make.
-    Colour co {pos.getSideToMove()}; // is this fine? (why not pass as arg?)
-    pos.makeMove(mv);
-    bool isSuicide {isInCheck(co, pos)};
-    pos.unmakeMove(mv);
-    return !isSuicide;
+    // Assumes move is valid. Uses the checkers and pinned units cached in the
+    // Position, so only en passant is tested by making the move.
+    const Colour co {pos.getSideToMove()};
+    if (isCastling(mv)) {
+        // Castling validity already includes the king's safety.
+        return !pos.getCheckers();
+    }
+    if (isEp(mv)) {
+        // Rare, and can uncover checks along the rank: make/unmake it.
+        pos.makeMove(mv);
+        const bool isSuicide {isInCheck(co, pos)};
+        pos.unmakeMove(mv);
+        return !isSuicide;
+    }
+    const Square ksq {lsb(pos.getUnitsBb(co, KING))};
+    const Square fromSq {getFromSq(mv)};
+    const Square toSq {getToSq(mv)};
+    if (fromSq == ksq) {
+        // The king must not step back along the ray of a checking slider.
+        return !attacksTo(toSq, !co, pos.getUnitsBb() ^ ksq, pos);
+    }
+    const Bitboard bbCheckers {pos.getCheckers()};
+    if (bbCheckers) {
+        // In double check only the king can move; in single check, other
+        // units must capture the checker or interpose.
+        if ((bbCheckers & (bbCheckers - 1)) ||
+            !((bbCheckers | betweenMasks[ksq][lsb(bbCheckers)]) & toSq)) {
+            return false;
+        }
+    }
+    return !(pos.getPinned(co) & fromSq) || (lineMasks[ksq][fromSq] & toSq);
 }
 
 
-uint64_t perft(int depth, Position& pos) {
-    // Recursive function to count all legal moves (nodes) at depth n.
-    uint64_t nodes = 0;
-    // Terminating condition
-    if (depth == 0) {return 1;}
-    
-    Movelist mvlist = generateLegalMoves(pos);
-    int sz = mvlist.size();
-    // Recurse.
-    for (int i = 0; i < sz; ++i) {
-        pos.makeMove(mvlist[i]);
-        int childN = perft(depth-1, pos);
-        nodes += childN;
-        pos.unmakeMove(mvlist[i]);
-    }
-    return nodes;
+bool isValid(Move mv, const Position& pos) {
+    // Test if a move (e.g. from a hash table) is valid in the position, i.e.
+    // is one that the add*Moves functions would generate for the side to move.
+    const Colour co {pos.getSideToMove()};
+    const Square fromSq {getFromSq(mv)};
+    const Square toSq {getToSq(mv)};
+    if (mv == NULL_MOVE || !(pos.getUnitsBb(co) & fromSq)) {
+        return false;
+    }
+    // Generated moves only set the promotion type bits for promotions.
+    if (!isPromotion(mv) && (mv >> 14)) {
+        return false;
+    }
+    if (isCastling(mv)) {
+        for (CastlingRights cr : CASTLE_LIST) {
+            if (toColour(cr) == co && pos.getOrigKingSq(cr) == fromSq &&
+                pos.getOrigRookSq(cr) == toSq) {
+                return isCastlingValid(cr, pos);
+            }
+        }
+        return false;
+    }
+    const PieceType pcty {getPieceType(pos.getPiece(fromSq))};
+    if (pcty != PAWN) {
+        return !isPromotion(mv) && !isEp(mv) &&
+               (attacksFrom(fromSq, co, pcty, pos) & ~pos.getUnitsBb(co) & toSq);
+    }
+    if (isEp(mv)) {
+        return toSq == pos.getEpSq() && (pawnAttacks[co][fromSq] & toSq);
+    }
+    // Promotions, and only promotions, must reach the last rank.
+    if (isPromotion(mv) != static_cast<bool>(toSq & BB_OUR_8[co])) {
+        return false;
+    }
+    const Bitboard bbAll {pos.getUnitsBb()};
+    if (pawnAttacks[co][fromSq] & toSq) {
+        return pos.getUnitsBb(!co) & toSq;
+    }
+    const Square sqPush {(co == WHITE) ? shiftN(fromSq) : shiftS(fromSq)};
+    if (sqPush & bbAll) {
+        return false;
+    }
+    if (toSq == sqPush) {
+        return true;
+    }
+    return (fromSq & BB_OUR_2[co]) && !(toSq & bbAll) &&
+           toSq == ((co == WHITE) ? shiftN(sqPush) : shiftS(sqPush));
 }
 
 
 // === Functions to generate valid moves of a particular type ===
 // Functions take in a Movelist and append to it the valid moves generated.
-Movelist& addKingMoves(Movelist& mvlist, Colour co, const Position& pos) {
+// Only moves to squares in bbTarget are generated (by default, all squares).
+Movelist& addKingMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget) {
     Bitboard bbFrom {pos.getUnitsBb(co, KING)};
     Bitboard bbFriendly {pos.getUnitsBb(co)};
     Square fromSq {NO_SQ};
     Bitboard bbTo {BB_NONE};
     while (bbFrom) {
         fromSq = popLsb(bbFrom);
-        bbTo = kingAttacks[fromSq] & ~bbFriendly;
+        bbTo = kingAttacks[fromSq] & ~bbFriendly & bbTarget;
         while (bbTo) {
             mvlist.push_back(buildMove(fromSq, popLsb(bbTo)));
         }
@@ -89,14 +240,15 @@ Movelist& addKingMoves(Movelist& mvlist, Colour co, const Position& pos) {
     return mvlist;
 }
 
-Movelist& addKnightMoves(Movelist& mvlist, Colour co, const Position& pos) {
+Movelist& addKnightMoves(Movelist& mvlist, Colour co, const Position& pos,
+                         Bitboard bbTarget) {
     Bitboard bbFrom {pos.getUnitsBb(co, KNIGHT)};
     Bitboard bbFriendly {pos.getUnitsBb(co)};
     Square fromSq {NO_SQ};
     Bitboard bbTo {BB_NONE};
     while (bbFrom) {
         fromSq = popLsb(bbFrom);
-        bbTo = knightAttacks[fromSq] & ~bbFriendly;
+        bbTo = knightAttacks[fromSq] & ~bbFriendly & bbTarget;
         while (bbTo) {
             mvlist.push_back(buildMove(fromSq, popLsb(bbTo)));
         }
@@ -104,7 +256,8 @@ Movelist& addKnightMoves(Movelist& mvlist, Colour co, const Position& pos) {
     return mvlist;
 }
 
-Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos) {
+Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos,
+                         Bitboard bbTarget) {
     Bitboard bbFrom {pos.getUnitsBb(co, BISHOP)};
     Bitboard bbFriendly {pos.getUnitsBb(co)};
     Bitboard bbAll {pos.getUnitsBb()};
@@ -112,9 +265,7 @@ Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos) {
     Bitboard bbTo {BB_NONE};
     while (bbFrom) {
         fromSq = popLsb(bbFrom);
-        bbTo = (findDiagAttacks(fromSq, bbAll) |
-                findAntidiagAttacks(fromSq, bbAll))
-               & ~bbFriendly;
+        bbTo = bishopAttacks(fromSq, bbAll) & ~bbFriendly & bbTarget;
         while (bbTo) {
             mvlist.push_back(buildMove(fromSq, popLsb(bbTo)));
         }
@@ -122,7 +273,8 @@ Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos) {
     return mvlist;
 }
 
-Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos) {
+Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget) {
     Bitboard bbFrom {pos.getUnitsBb(co, ROOK)};
     Bitboard bbFriendly {pos.getUnitsBb(co)};
     Bitboard bbAll {pos.getUnitsBb()};
@@ -130,9 +282,7 @@ Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos) {
     Bitboard bbTo {BB_NONE};
     while (bbFrom) {
         fromSq = popLsb(bbFrom);
-        bbTo = (findRankAttacks(fromSq, bbAll) |
-                findFileAttacks(fromSq, bbAll))
-               & ~bbFriendly;
+        bbTo = rookAttacks(fromSq, bbAll) & ~bbFriendly & bbTarget;
         while (bbTo) {
             mvlist.push_back(buildMove(fromSq, popLsb(bbTo)));
         }
@@ -140,7 +290,8 @@ Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos) {
     return mvlist;
 }
 
-Movelist& addQueenMoves(Movelist& mvlist, Colour co, const Position& pos) {
+Movelist& addQueenMoves(Movelist& mvlist, Colour co, const Position& pos,
+                        Bitboard bbTarget) {
     Bitboard bbFrom {pos.getUnitsBb(co, QUEEN)};
     Bitboard bbFriendly {pos.getUnitsBb(co)};
     Bitboard bbAll {pos.getUnitsBb()};
@@ -148,11 +299,7 @@ Movelist& addQueenMoves(Movelist& mvlist, Colour co, const Position& pos) {
     Bitboard bbTo {BB_NONE};
     while (bbFrom) {
         fromSq = popLsb(bbFrom);
-        bbTo = (findRankAttacks(fromSq, bbAll) |
-                findFileAttacks(fromSq, bbAll) |
-                findDiagAttacks(fromSq, bbAll) |
-                findAntidiagAttacks(fromSq, bbAll))
-               & ~bbFriendly;
+        bbTo = queenAttacks(fromSq, bbAll) & ~bbFriendly & bbTarget;
         while (bbTo) {
             mvlist.push_back(buildMove(fromSq, popLsb(bbTo)));
         }
@@ -173,73 +320,110 @@ Movelist& addPawnAttacks(Movelist& mvlist, Colour co, const Position& pos) {
     return mvlist;
 }
 
-Movelist& addPawnMoves(Movelist& mvlist, Colour co, const Position& pos) {
+// Helpers for set-wise pawn generation: add a move to each square of bbTo,
+// from the square offset behind it. The from-squares are those of existing
+// pawns, so need no range check.
+inline void addPawnTargets(Movelist& mvlist, Bitboard bbTo, int offset) {
+    while (bbTo) {
+        const Square toSq {popLsb(bbTo)};
+        mvlist.push_back(buildMove(static_cast<Square>(toSq - offset), toSq));
+    }
+    return;
+}
+
+inline void addPromotionTargets(Movelist& mvlist, Bitboard bbTo, int offset) {
+    while (bbTo) {
+        const Square toSq {popLsb(bbTo)};
+        const Square fromSq {static_cast<Square>(toSq - offset)};
+        mvlist.push_back(buildPromotion(fromSq, toSq, KNIGHT));
+        mvlist.push_back(buildPromotion(fromSq, toSq, BISHOP));
+        mvlist.push_back(buildPromotion(fromSq, toSq, ROOK));
+        mvlist.push_back(buildPromotion(fromSq, toSq, QUEEN));
+    }
+    return;
+}
+
+template <Colour co>
+Movelist& addPawnMoves(Movelist& mvlist, const Position& pos,
+                       Bitboard bbTarget) {
     // Generates moves, captures, double moves, promotions (and captures).
     // Does not generate en passant moves.
-    Bitboard bbFrom {pos.getUnitsBb(co, PAWN)};
-    Square toSq {NO_SQ};
+    // Works on all pawns at once: each kind of move is a shift of the pawn
+    // bitboard, so its target squares are found set-wise, and each from-square
+    // is a fixed offset from its target square.
+    constexpr int PUSH {(co == WHITE) ? 8 : -8};
+    constexpr int CAPTURE_W {(co == WHITE) ? 7 : -9};
+    constexpr int CAPTURE_E {(co == WHITE) ? 9 : -7};
+    // Pawns which can double move are on this rank after a single move.
+    constexpr Bitboard BB_OUR_3 {(co == WHITE) ? BB_3 : BB_6};
     
-    Bitboard bbEnemy {pos.getUnitsBb(!co)};
-    Bitboard bbAll {pos.getUnitsBb()};
+    const Bitboard bbPawns {pos.getUnitsBb(co, PAWN)};
+    const Bitboard bbEmpty {~pos.getUnitsBb()};
+    const Bitboard bbEnemy {pos.getUnitsBb(!co) & bbTarget};
     
-    while (bbFrom) {
-        Square fromSq {popLsb(bbFrom)};
-        // Generate captures (and capture promotions).
-        Bitboard bbAttacks {pawnAttacks[co][fromSq] & bbEnemy};
-        while (bbAttacks) {
-            toSq = popLsb(bbAttacks);
-            if (toSq & BB_OUR_8[co]) {
-                mvlist.push_back(buildPromotion(fromSq, toSq, KNIGHT));
-                mvlist.push_back(buildPromotion(fromSq, toSq, BISHOP));
-                mvlist.push_back(buildPromotion(fromSq, toSq, ROOK));
-                mvlist.push_back(buildPromotion(fromSq, toSq, QUEEN));
-            } else {
-                mvlist.push_back(buildMove(fromSq, toSq));
-            }
-        }
-        // Generate single (and promotions) and double moves.
-        toSq = (co == WHITE) ? shiftN(fromSq) : shiftS(fromSq);
-        if (!(toSq & bbAll)) {
-            // Single moves (and promtions).
-            if (toSq & BB_OUR_8[co]) {
-                mvlist.push_back(buildPromotion(fromSq, toSq, KNIGHT));
-                mvlist.push_back(buildPromotion(fromSq, toSq, BISHOP));
-                mvlist.push_back(buildPromotion(fromSq, toSq, ROOK));
-                mvlist.push_back(buildPromotion(fromSq, toSq, QUEEN));
-            } else {
-                mvlist.push_back(buildMove(fromSq, toSq));
-            }
-            // Double moves
-            if (fromSq & BB_OUR_2[co]) {
-                toSq = (co == WHITE)
-                    ? shiftN(shiftN(fromSq))
-                    : shiftS(shiftS(fromSq));
-                if (!(toSq & bbAll)) {
-                    mvlist.push_back(buildMove(fromSq, toSq));
-                }
-            }
-        }
-    }
+    Bitboard bbSingle {
+        ((co == WHITE) ? shiftN(bbPawns) : shiftS(bbPawns)) & bbEmpty
+    };
+    // The single step need not be a target square for a double move.
+    const Bitboard bbDouble {
+        ((co == WHITE) ? shiftN(bbSingle & BB_OUR_3)
+                       : shiftS(bbSingle & BB_OUR_3)) & bbEmpty & bbTarget
+    };
+    bbSingle &= bbTarget;
+    const Bitboard bbCaptureW {
+        ((co == WHITE) ? shiftNW(bbPawns) : shiftSW(bbPawns)) & bbEnemy
+    };
+    const Bitboard bbCaptureE {
+        ((co == WHITE) ? shiftNE(bbPawns) : shiftSE(bbPawns)) & bbEnemy
+    };
+    
+    addPromotionTargets(mvlist, bbCaptureW & BB_OUR_8[co], CAPTURE_W);
+    addPromotionTargets(mvlist, bbCaptureE & BB_OUR_8[co], CAPTURE_E);
+    addPromotionTargets(mvlist, bbSingle & BB_OUR_8[co], PUSH);
+    addPawnTargets(mvlist, bbCaptureW & ~BB_OUR_8[co], CAPTURE_W);
+    addPawnTargets(mvlist, bbCaptureE & ~BB_OUR_8[co], CAPTURE_E);
+    addPawnTargets(mvlist, bbSingle & ~BB_OUR_8[co], PUSH);
+    addPawnTargets(mvlist, bbDouble, 2 * PUSH);
     return mvlist;
 }
 
-Movelist& addEpMoves(Movelist& mvlist, Colour co, const Position& pos) {
+Movelist& addPawnMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget) {
+    return (co == WHITE) ? addPawnMoves<WHITE>(mvlist, pos, bbTarget)
+                         : addPawnMoves<BLACK>(mvlist, pos, bbTarget);
+}
+
+template <Colour co>
+Movelist& addEpMoves(Movelist& mvlist, const Position& pos) {
     Square toSq {pos.getEpSq()}; // only one possible ep square at all times.
-    Square fromSq {NO_SQ};
-    Bitboard bbEp {bbFromSq(toSq)};
-    // each ep square could have 2 pawns moving to it.
-    Bitboard bbEpFrom { (co == WHITE)
-        ? (shiftSW(bbEp) | shiftSE(bbEp))
-        : (shiftNW(bbEp) | shiftNE(bbEp))
-    };
-    Bitboard bbEpPawns {bbEpFrom & pos.getUnitsBb(co, PAWN)};
+    if (toSq == NO_SQ) {
+        return mvlist;
+    }
+    // Each ep square could have 2 pawns moving to it: those which an enemy
+    // pawn on the ep square would attack.
+    Bitboard bbEpPawns {pawnAttacks[!co][toSq] & pos.getUnitsBb(co, PAWN)};
     while (bbEpPawns) {
-        fromSq = popLsb(bbEpPawns);
-        mvlist.push_back(buildEp(fromSq, toSq));
+        mvlist.push_back(buildEp(popLsb(bbEpPawns), toSq));
     }
     return mvlist;
 }
 
+Movelist& addEpMoves(Movelist& mvlist, Colour co, const Position& pos) {
+    return (co == WHITE) ? addEpMoves<WHITE>(mvlist, pos)
+                         : addEpMoves<BLACK>(mvlist, pos);
+}
+
+static bool isCastlingPathClear(CastlingRights cr, const Position& pos) {
+    // Tests if king or rook has moved, and if their paths are clear.
+    if (!(cr & pos.getCastlingRights())) {
+        return false;
+    }
+    const Bitboard bbOthers {pos.getUnitsBb() ^ pos.getOrigKingSq(cr) ^
+                             pos.getOrigRookSq(cr)};
+    return !((pos.getCastlingRookMask(cr) | pos.getCastlingKingMask(cr)) &
+             bbOthers);
+}
+
 bool isCastlingValid(CastlingRights cr, const Position& pos) {
     // Helper function to test if a particular castling is valid.
     // Takes [CastlingRights cr] corresponding to a single castling.
@@ -252,23 +436,24 @@ bool isCastlingValid(CastlingRights cr, const Position& pos) {
     // for checks after the move has been *made*. (Not in regular chess, but in
     // 960, or with certain fairy pieces, it is *necessary*.)
     
-    // Test if king or relevant rook have moved.
-    if (!(cr & pos.getCastlingRights())) {
+    if (!isCastlingPathClear(cr, pos)) {
         return false;
     }
-    Bitboard rookMask {pos.getCastlingRookMask(cr)};
+    // Test if there are attacked squares in the king's path. If it is this
+    // side's move, whether the king's own square is attacked (in check) may
+    // already be known from the Position's CheckInfo.
+    const Colour co {toColour(cr)};
+    const Square ksq {pos.getOrigKingSq(cr)};
     Bitboard kingMask {pos.getCastlingKingMask(cr)};
-    Bitboard bbOthers {pos.getUnitsBb() ^ pos.getOrigKingSq(cr) ^
-                       pos.getOrigRookSq(cr)};
-    // Test if king and rook paths are clear of obstruction.
-    if ((rookMask | kingMask) & bbOthers) {
-        return false;
+    const CheckInfo* ci {pos.findCheckInfo()};
+    if (ci && co == pos.getSideToMove() && (pos.getUnitsBb(co, KING) & ksq)) {
+        if (ci->bbCheckers) {
+            return false;
+        }
+        kingMask ^= ksq;
     }
-    // Test if there are attacked squares in the king's path.
-    Square sq {NO_SQ};
     while (kingMask) {
-        sq = popLsb(kingMask);
-        if (isAttacked(sq, !toColour(cr), pos)) {
+        if (isAttacked(popLsb(kingMask), !co, pos)) {
             return false;
         }
     }
@@ -276,24 +461,33 @@ bool isCastlingValid(CastlingRights cr, const Position& pos) {
     return true;
 }
 
-Movelist& addCastlingMoves(Movelist& mvlist, Colour co, const Position& pos) {
-    if (co == WHITE) {
-        if (isCastlingValid(CASTLE_WSHORT, pos)) {
-            Move mv {buildCastling(pos.getOrigKingSq(CASTLE_WSHORT), pos.getOrigRookSq(CASTLE_WSHORT))};
-            mvlist.push_back(mv);
-        }
-        if (isCastlingValid(CASTLE_WLONG, pos)) {
-            Move mv {buildCastling(pos.getOrigKingSq(CASTLE_WLONG), pos.getOrigRookSq(CASTLE_WLONG))};
-            mvlist.push_back(mv);
+template <Colour co>
+Movelist& addCastlingMoves(Movelist& mvlist, const Position& pos,
+                           Bitboard bbAttacked) {
+    // For the legal move generator, when not in check. bbAttacked is the enemy
+    // attack map it has worked out, which replaces isCastlingValid's square by
+    // square tests. (It was worked out with the king removed, which only adds
+    // squares past the king along lines through it; those would be attacked
+    // through the king only if it were in check.)
+    constexpr CastlingRights CR_SHORT {(co == WHITE) ? CASTLE_WSHORT
+                                                     : CASTLE_BSHORT};
+    constexpr CastlingRights CR_LONG {(co == WHITE) ? CASTLE_WLONG
+                                                    : CASTLE_BLONG};
+    for (CastlingRights cr : {CR_SHORT, CR_LONG}) {
+        if (isCastlingPathClear(cr, pos) &&
+            !(pos.getCastlingKingMask(cr) & bbAttacked)) {
+            mvlist.push_back(buildCastling(pos.getOrigKingSq(cr),
+                                           pos.getOrigRookSq(cr)));
         }
-    } else if (co == BLACK) {
-        if (isCastlingValid(CASTLE_BSHORT, pos)) {
-            Move mv {buildCastling(pos.getOrigKingSq(CASTLE_BSHORT), pos.getOrigRookSq(CASTLE_BSHORT))};
-            mvlist.push_back(mv);
-        }
-        if (isCastlingValid(CASTLE_BLONG, pos)) {
-            Move mv {buildCastling(pos.getOrigKingSq(CASTLE_BLONG), pos.getOrigRookSq(CASTLE_BLONG))};
-            mvlist.push_back(mv);
+    }
+    return mvlist;
+}
+
+Movelist& addCastlingMoves(Movelist& mvlist, Colour co, const Position& pos) {
+    for (CastlingRights cr : CASTLE_LIST) {
+        if (toColour(cr) == co && isCastlingValid(cr, pos)) {
+            mvlist.push_back(buildCastling(pos.getOrigKingSq(cr),
+                                           pos.getOrigRookSq(cr)));
         }
     }
     return mvlist;
@@ -316,14 +510,13 @@ Bitboard attacksFrom(Square sq, Colour co, PieceType pcty,
         bbAttacked = knightAttacks[sq];
         break;
     case BISHOP:
-        bbAttacked = findDiagAttacks(sq, bbAll) | findAntidiagAttacks(sq, bbAll);
+        bbAttacked = bishopAttacks(sq, bbAll);
         break;
     case ROOK:
-        bbAttacked = findRankAttacks(sq, bbAll) | findFileAttacks(sq, bbAll);
+        bbAttacked = rookAttacks(sq, bbAll);
         break;
     case QUEEN:
-        bbAttacked = findRankAttacks(sq, bbAll) | findFileAttacks(sq, bbAll) |
-                     findDiagAttacks(sq, bbAll) | findAntidiagAttacks(sq, bbAll);
+        bbAttacked = queenAttacks(sq, bbAll);
         break;
     case KING:
         bbAttacked = kingAttacks[sq];
@@ -335,16 +528,20 @@ Bitboard attacksFrom(Square sq, Colour co, PieceType pcty,
 
 Bitboard attacksTo(Square sq, Colour co, const Position& pos) {
     // Returns bitboard of units of a given colour that attack a given square.
+    return attacksTo(sq, co, pos.getUnitsBb(), pos);
+}
+
+Bitboard attacksTo(Square sq, Colour co, Bitboard bbAll, const Position& pos) {
+    // As above, but with sliders blocked by the occupancy bbAll (which may
+    // differ from the position's, e.g. with a king removed).
     // In chess, most piece types have the following property: if piece PC is on
     // square SQ_A attacking SQ_B, then from SQ_B it would attack SQ_A.
     Bitboard bbAttackers {0};
     bbAttackers = kingAttacks[sq] & pos.getUnitsBb(co, KING);
     bbAttackers |= knightAttacks[sq] & pos.getUnitsBb(co, KNIGHT);
-    bbAttackers |= (findDiagAttacks(sq, pos.getUnitsBb()) |
-                    findAntidiagAttacks(sq, pos.getUnitsBb()))
+    bbAttackers |= bishopAttacks(sq, bbAll)
                    & (pos.getUnitsBb(co, BISHOP) | pos.getUnitsBb(co, QUEEN));
-    bbAttackers |= (findRankAttacks(sq, pos.getUnitsBb()) |
-                    findFileAttacks(sq, pos.getUnitsBb()))
+    bbAttackers |= rookAttacks(sq, bbAll)
                    & (pos.getUnitsBb(co, ROOK) | pos.getUnitsBb(co, QUEEN));
     // But for pawns, a square SQ_A is attacked by a [Colour] pawn on SQ_B,
     // if a [!Colour] pawn on SQ_A would attack SQ_B.
@@ -352,7 +549,59 @@ Bitboard attacksTo(Square sq, Colour co, const Position& pos) {
     return bbAttackers;
 }
 
+Bitboard attacksTo(Square sq, Bitboard bbAll, const Position& pos) {
+    // As above, but units of both colours.
+    const Bitboard bbDiagSliders {pos.getUnitsBb(BISHOP) | pos.getUnitsBb(QUEEN)};
+    const Bitboard bbOrthoSliders {pos.getUnitsBb(ROOK) | pos.getUnitsBb(QUEEN)};
+    return (kingAttacks[sq] & pos.getUnitsBb(KING)) |
+           (knightAttacks[sq] & pos.getUnitsBb(KNIGHT)) |
+           (bishopAttacks(sq, bbAll) & bbDiagSliders) |
+           (rookAttacks(sq, bbAll) & bbOrthoSliders) |
+           (pawnAttacks[BLACK][sq] & pos.getUnitsBb(WHITE, PAWN)) |
+           (pawnAttacks[WHITE][sq] & pos.getUnitsBb(BLACK, PAWN));
+}
+
 bool isAttacked(Square sq, Colour co, const Position& pos) {
     // Returns if a square is attacked by pieces of a particular colour.
     return !(attacksTo(sq, co, pos) == BB_NONE);
+}
+
+Bitboard attackMap(Colour co, Bitboard bbAll, const Position& pos) {
+    // Returns bitboard of all squares attacked by units of a given colour,
+    // with sliders blocked by the occupancy bbAll (which may differ from the
+    // position's, e.g. with a king removed).
+    Bitboard bbPawns {pos.getUnitsBb(co, PAWN)};
+    Bitboard bbAttacked { (co == WHITE)
+        ? (shiftNW(bbPawns) | shiftNE(bbPawns))
+        : (shiftSW(bbPawns) | shiftSE(bbPawns))
+    };
+    Bitboard bbFrom {pos.getUnitsBb(co, KNIGHT)};
+    while (bbFrom) {
+        bbAttacked |= knightAttacks[popLsb(bbFrom)];
+    }
+    bbFrom = pos.getUnitsBb(co, BISHOP) | pos.getUnitsBb(co, QUEEN);
+    while (bbFrom) {
+        Square sq {popLsb(bbFrom)};
+        bbAttacked |= bishopAttacks(sq, bbAll);
+    }
+    bbFrom = pos.getUnitsBb(co, ROOK) | pos.getUnitsBb(co, QUEEN);
+    while (bbFrom) {
+        Square sq {popLsb(bbFrom)};
+        bbAttacked |= rookAttacks(sq, bbAll);
+    }
+    bbFrom = pos.getUnitsBb(co, KING);
+    while (bbFrom) {
+        bbAttacked |= kingAttacks[popLsb(bbFrom)];
+    }
+    return bbAttacked;
+}
+
+Bitboard findPinned(Colour co, const Position& pos) {
+    // Returns bitboard of units of a given colour pinned to their own king:
+    // those alone between it and an enemy slider (from the Position's
+    // CheckInfo, worked out here without keeping it if not yet known).
+    const CheckInfo* ci {pos.findCheckInfo()};
+    const Bitboard bbBlockers {ci ? ci->bbBlockers[co]
+                                  : pos.computeCheckInfo().bbBlockers[co]};
+    return bbBlockers & pos.getUnitsBb(co);
 }
\ No newline at end of file
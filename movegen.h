@@ -23,21 +23,39 @@
 
 class Position;
 
-Movelist generateLegalMoves(Position& pos);
+// === Generation modes ===
+// GEN_ALL: all legal moves.
+// GEN_CAPTURES: legal captures (including en passant) and promotions (all
+// promotions, including non-capturing ones), e.g. for quiescence-style scans.
+// GEN_QUIETS: the other legal moves: non-capturing, non-promoting moves and
+// castling. Together with GEN_CAPTURES, this gives all legal moves.
+// GEN_EVASIONS: all legal moves when in check (king moves, captures of the
+// checker and interpositions), and none when not in check.
+enum GenType {
+    GEN_ALL, GEN_CAPTURES, GEN_QUIETS, GEN_EVASIONS
+};
+
+Movelist generateLegalMoves(Position& pos, GenType gt = GEN_ALL);
 bool isInCheck(Colour co, const Position& pos);
 bool isLegal(Move mv, Position& pos);
-
-uint64_t perft(int depth, Position& pos);
+bool isValid(Move mv, const Position& pos);
 
 // === Functions to generate particular types of valid moves ===
-Movelist& addKingMoves(Movelist& mvlist, Colour co, const Position& pos);
-Movelist& addKnightMoves(Movelist& mvlist, Colour co, const Position& pos);
-Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos);
-Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos);
-Movelist& addQueenMoves(Movelist& mvlist, Colour co, const Position& pos);
+// Only moves to squares in bbTarget are generated.
+Movelist& addKingMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget = BB_ALL);
+Movelist& addKnightMoves(Movelist& mvlist, Colour co, const Position& pos,
+                         Bitboard bbTarget = BB_ALL);
+Movelist& addBishopMoves(Movelist& mvlist, Colour co, const Position& pos,
+                         Bitboard bbTarget = BB_ALL);
+Movelist& addRookMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget = BB_ALL);
+Movelist& addQueenMoves(Movelist& mvlist, Colour co, const Position& pos,
+                        Bitboard bbTarget = BB_ALL);
 
 Movelist& addPawnAttacks(Movelist& mvlist, Colour co, const Position& pos);
-Movelist& addPawnMoves(Movelist& mvlist, Colour co, const Position& pos);
+Movelist& addPawnMoves(Movelist& mvlist, Colour co, const Position& pos,
+                       Bitboard bbTarget = BB_ALL);
 Movelist& addEpMoves(Movelist& mvlist, Colour co, const Position& pos);
 
 bool isCastlingValid(CastlingRights cr, const Position& pos);
@@ -46,6 +64,10 @@ Movelist& addCastlingMoves(Movelist& mvlist, Colour co, const Position& pos);
 // === Useful auxiliary functions ===
 Bitboard attacksFrom(Square sq, Colour co, PieceType pcty, const Position& pos);
 Bitboard attacksTo(Square sq, Colour co, const Position& pos);
+Bitboard attacksTo(Square sq, Colour co, Bitboard bbAll, const Position& pos);
+Bitboard attacksTo(Square sq, Bitboard bbAll, const Position& pos);
 bool isAttacked(Square sq, Colour co, const Position& pos);
+Bitboard attackMap(Colour co, Bitboard bbAll, const Position& pos);
+Bitboard findPinned(Colour co, const Position& pos);
 
 #endif //#ifndef MOVEGEN_INCLUDED
\ No newline at end of file
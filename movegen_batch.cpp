@@ -0,0 +1,141 @@
+#include "movegen_batch.h"
+
+#include "move.h"
+#include "movegen.h"
+#include "position.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+BatchMovegen::BatchMovegen(int numThreads, size_t chunkSize) :
+    chunkSize {std::max<size_t>(chunkSize, 1)} {
+    for (int i = 1; i < numThreads; ++i) {
+        workers.emplace_back(&BatchMovegen::workerLoop, this);
+    }
+}
+
+BatchMovegen::~BatchMovegen() {
+    {
+        std::lock_guard<std::mutex> lock {mtx};
+        isStopping = true;
+    }
+    cvStart.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void BatchMovegen::generate(Position* positions, size_t numPositions,
+                            MoveBatch& batch, GenType gt) {
+    this->positions = positions;
+    this->numPositions = numPositions;
+    this->gt = gt;
+    this->batch = &batch;
+    batch.offsets.resize(numPositions);
+    batch.counts.resize(numPositions);
+    const size_t numChunks {(numPositions + chunkSize - 1) / chunkSize};
+    if (chunkMoves.size() < numChunks) {
+        chunkMoves.resize(numChunks);
+    }
+    chunkOffsets.resize(numChunks);
+    
+    runStage(STAGE_GENERATE, numChunks);
+    // Each chunk's moves go after those of the chunks before it.
+    uint64_t numMoves {0};
+    for (size_t i = 0; i < numChunks; ++i) {
+        chunkOffsets[i] = numMoves;
+        numMoves += chunkMoves[i].size();
+    }
+    // Uninitialised: the copy stage writes every move.
+    batch.moves.resize(numMoves);
+    runStage(STAGE_COPY, numChunks);
+    return;
+}
+
+
+// === Stages ===
+void BatchMovegen::generateChunk(size_t iChunk) {
+    // Offsets are relative to the chunk until it is copied into place.
+    std::vector<Move>& moves {chunkMoves[iChunk]};
+    moves.clear();
+    const size_t last {std::min(numPositions, (iChunk + 1) * chunkSize)};
+    for (size_t i = iChunk * chunkSize; i < last; ++i) {
+        const Movelist mvlist {generateLegalMoves(positions[i], gt)};
+        batch->offsets[i] = moves.size();
+        batch->counts[i] = static_cast<uint32_t>(mvlist.size());
+        moves.insert(moves.end(), mvlist.begin(), mvlist.end());
+    }
+    return;
+}
+
+void BatchMovegen::copyChunk(size_t iChunk) {
+    const std::vector<Move>& moves {chunkMoves[iChunk]};
+    if (!moves.empty()) {
+        std::memcpy(batch->moves.data() + chunkOffsets[iChunk], moves.data(),
+                    moves.size() * sizeof(Move));
+    }
+    const size_t last {std::min(numPositions, (iChunk + 1) * chunkSize)};
+    for (size_t i = iChunk * chunkSize; i < last; ++i) {
+        batch->offsets[i] += chunkOffsets[iChunk];
+    }
+    return;
+}
+
+
+// === Pool ===
+void BatchMovegen::runStage(Stage st, size_t n) {
+    // No worker is running tasks between stages, so the stage can be set.
+    {
+        std::lock_guard<std::mutex> lock {mtx};
+        stage = st;
+        numTasks = n;
+        iNextTask = 0;
+        numJoined = 0;
+        ++numStagesRun;
+    }
+    cvStart.notify_all();
+    runTasks();
+    // All tasks are taken; wait for the workers still running theirs.
+    std::unique_lock<std::mutex> lock {mtx};
+    cvDone.wait(lock, [this]() {
+        return numJoined == static_cast<int>(workers.size()) && numBusy == 0;
+    });
+    return;
+}
+
+void BatchMovegen::runTasks() {
+    for (size_t i = iNextTask++; i < numTasks; i = iNextTask++) {
+        if (stage == STAGE_GENERATE) {
+            generateChunk(i);
+        } else {
+            copyChunk(i);
+        }
+    }
+    return;
+}
+
+void BatchMovegen::workerLoop() {
+    uint64_t numStagesSeen {0};
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock {mtx};
+            cvStart.wait(lock, [&]() {
+                return isStopping || numStagesRun != numStagesSeen;
+            });
+            if (isStopping) {return;}
+            numStagesSeen = numStagesRun;
+            ++numJoined;
+            ++numBusy;
+        }
+        runTasks();
+        {
+            std::lock_guard<std::mutex> lock {mtx};
+            --numBusy;
+        }
+        cvDone.notify_one();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef MOVEGEN_BATCH_INCLUDED
+#define MOVEGEN_BATCH_INCLUDED
+
+#include "move.h"
+#include "movegen.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// === movegen_batch.h ===
+// Legal move generation for many positions at once, on a pool of threads, for
+// callers with a batch of positions to hand (instead of calling
+// generateLegalMoves once per position).
+
+class Position;
+
+// An allocator for vectors that are always written to after resizing: new
+// elements are default-initialised (so left uninitialised, for Move) instead
+// of zeroed as with std::allocator.
+template <typename T>
+struct UninitAllocator : std::allocator<T> {
+    template <typename U> struct rebind {using other = UninitAllocator<U>;};
+    UninitAllocator() = default;
+    template <typename U>
+    UninitAllocator(const UninitAllocator<U>&) noexcept {}
+    template <typename U>
+    void construct(U* p) {::new (static_cast<void*>(p)) U;}
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+// === MoveBatch ===
+// The moves of a batch of positions, in one flat buffer: position i's moves
+// are moves[offsets[i]] to moves[offsets[i] + counts[i] - 1], in the order
+// generateLegalMoves gives them. Positions' moves are stored in batch order,
+// so the buffer can be streamed front to back. Reusing a MoveBatch for later
+// batches reuses its memory.
+struct MoveBatch {
+    std::vector<Move, UninitAllocator<Move>> moves;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> counts;
+};
+
+// === BatchMovegen ===
+// Owns a persistent pool of worker threads. Each batch is cut into chunks of
+// consecutive positions, which the workers (and the calling thread) take in
+// turn, so uneven chunks balance out. Each chunk's moves go to a scratch
+// buffer of the chunk's own; once all are done, the chunks are copied into
+// place in the flat buffer, also in parallel. The scratch buffers are kept
+// between batches, so a steady stream of similar batches stops allocating.
+//
+// With numThreads 1 there are no workers: generate() runs on the calling
+// thread alone.
+//
+// Usage:
+//     BatchMovegen gen {numThreads};
+//     MoveBatch batch;
+//     gen.generate(positions.data(), positions.size(), batch);
+// generate() fills batch with the moves of positions[0, numPositions) of type
+// gt, as generateLegalMoves would give them, and returns once all are done.
+// The positions are not const because, as with generateLegalMoves, finding
+// their moves fills in each one's CheckInfo cache (see Position::getCheckInfo)
+// if it is not yet worked out; nothing else about them changes. So a position
+// must not appear twice in one batch, nor be used by another thread during
+// generate(). One thread at a time may call generate().
+class BatchMovegen {
+    public:
+        // Starts numThreads - 1 workers: the calling thread is the last.
+        explicit BatchMovegen(int numThreads = 1, size_t chunkSize = 64);
+        ~BatchMovegen();
+        BatchMovegen(const BatchMovegen&) = delete;
+        BatchMovegen& operator=(const BatchMovegen&) = delete;
+        
+        void generate(Position* positions, size_t numPositions,
+                      MoveBatch& batch, GenType gt = GEN_ALL);
+        int getNumThreads() const {return static_cast<int>(workers.size()) + 1;}
+    
+    private:
+        enum Stage {STAGE_GENERATE, STAGE_COPY};
+        
+        // The pool: workers wait for the stage count to change, then all
+        // threads take tasks (chunks) until none are left. A stage ends once
+        // every worker has joined it and left, so no worker can be late for
+        // one stage while the next is being set up.
+        std::vector<std::thread> workers;
+        std::mutex mtx;
+        std::condition_variable cvStart;
+        std::condition_variable cvDone;
+        uint64_t numStagesRun {0};
+        bool isStopping {false};
+        int numJoined {0}; // workers that have joined the current stage
+        int numBusy {0}; // of those, the ones still taking tasks
+        Stage stage {STAGE_GENERATE};
+        size_t numTasks {0};
+        std::atomic<size_t> iNextTask {0};
+        
+        // The batch being generated, and the chunks' scratch buffers.
+        const size_t chunkSize;
+        Position* positions {nullptr};
+        size_t numPositions {0};
+        GenType gt {GEN_ALL};
+        MoveBatch* batch {nullptr};
+        std::vector<std::vector<Move>> chunkMoves;
+        std::vector<uint64_t> chunkOffsets;
+        
+        void workerLoop();
+        void runStage(Stage st, size_t n);
+        void runTasks();
+        void generateChunk(size_t iChunk);
+        void copyChunk(size_t iChunk);
+};
+
+#endif //#ifndef MOVEGEN_BATCH_INCLUDED
\ No newline at end of file
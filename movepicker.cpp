@@ -0,0 +1,135 @@
+#include "movepicker.h"
+
+#include "chess_types.h"
+#include "bitboard.h"
+#include "bitboard_lookup.h"
+#include "move.h"
+#include "movegen.h"
+#include "position.h"
+
+MovePicker::MovePicker(Position& pos, Move hashMove) :
+    pos {pos}, hashMove {hashMove}, co {pos.getSideToMove()},
+    ksq {lsb(pos.getUnitsBb(co, KING))},
+    bbCheckers {pos.getCheckers()} {
+    if (bbCheckers) {
+        bbEvasions = bbCheckers | betweenMasks[ksq][lsb(bbCheckers)];
+    }
+}
+
+Move MovePicker::next() {
+    while (true) {
+        switch (stage) {
+        case STAGE_HASH:
+            stage = STAGE_GEN_CAPTURES;
+            if (hashMove != NULL_MOVE && isValid(hashMove, pos) &&
+                isLegal(hashMove, pos)) {
+                return hashMove;
+            }
+            break;
+        case STAGE_GEN_CAPTURES:
+            generateCaptures();
+            stage = STAGE_CAPTURES;
+            break;
+        case STAGE_CAPTURES:
+            while (idx < mvlist.size()) {
+                Move mv {pickBest()};
+                if (mv != hashMove && isLegal(mv, pos)) {
+                    return mv;
+                }
+            }
+            stage = STAGE_GEN_QUIETS;
+            break;
+        case STAGE_GEN_QUIETS:
+            generateQuiets();
+            stage = STAGE_QUIETS;
+            break;
+        case STAGE_QUIETS:
+            while (idx < mvlist.size()) {
+                Move mv {mvlist[idx++]};
+                if (mv != hashMove && isLegal(mv, pos)) {
+                    return mv;
+                }
+            }
+            stage = STAGE_DONE;
+            break;
+        case STAGE_DONE:
+            return NULL_MOVE;
+        }
+    }
+}
+
+
+// === Stage providers ===
+// The add*Moves functions, restricted to the stage's target squares. In check,
+// non-king moves are also restricted to those that might resolve the check.
+void MovePicker::generateCaptures() {
+    mvlist.clear();
+    idx = 0;
+    const Bitboard bbEnemy {pos.getUnitsBb(!co)};
+    addKingMoves(mvlist, co, pos, bbEnemy);
+    // In double check, only the king can move.
+    if (!(bbCheckers & (bbCheckers - 1))) {
+        const Bitboard bbTarget {bbEnemy & bbEvasions};
+        addKnightMoves(mvlist, co, pos, bbTarget);
+        addBishopMoves(mvlist, co, pos, bbTarget);
+        addRookMoves(mvlist, co, pos, bbTarget);
+        addQueenMoves(mvlist, co, pos, bbTarget);
+        // Pushes to the last rank are promotions, so belong to this stage.
+        const Bitboard bbPromo {BB_OUR_8[co] & ~pos.getUnitsBb()};
+        addPawnMoves(mvlist, co, pos, (bbEnemy | bbPromo) & bbEvasions);
+        addEpMoves(mvlist, co, pos);
+    }
+    // Score by MVV-LVA: most valuable victim, then least valuable attacker.
+    // A promotion counts as capturing the piece promoted to.
+    for (size_t i = 0; i < mvlist.size(); ++i) {
+        const Move mv {mvlist[i]};
+        const Piece pcVictim {pos.getPiece(getToSq(mv))};
+        int score {KING - getPieceType(pos.getPiece(getFromSq(mv)))};
+        if (isEp(mv)) {
+            score += 8 * (PAWN + 1);
+        } else if (pcVictim != NO_PIECE) {
+            score += 8 * (getPieceType(pcVictim) + 1);
+        }
+        if (isPromotion(mv)) {
+            score += 8 * getPromotionType(mv);
+        }
+        mvlist.setScore(i, score);
+    }
+    return;
+}
+
+void MovePicker::generateQuiets() {
+    mvlist.clear();
+    idx = 0;
+    const Bitboard bbEmpty {~pos.getUnitsBb()};
+    addKingMoves(mvlist, co, pos, bbEmpty);
+    if (!(bbCheckers & (bbCheckers - 1))) {
+        const Bitboard bbTarget {bbEmpty & bbEvasions};
+        addKnightMoves(mvlist, co, pos, bbTarget);
+        addBishopMoves(mvlist, co, pos, bbTarget);
+        addRookMoves(mvlist, co, pos, bbTarget);
+        addQueenMoves(mvlist, co, pos, bbTarget);
+        addPawnMoves(mvlist, co, pos, bbTarget & ~BB_OUR_8[co]);
+    }
+    if (!bbCheckers) {
+        addCastlingMoves(mvlist, co, pos);
+    }
+    return;
+}
+
+Move MovePicker::pickBest() {
+    // Selection sort, one step at a time: usually only a few are picked.
+    size_t iBest {idx};
+    for (size_t i = idx + 1; i < mvlist.size(); ++i) {
+        if (mvlist.getScore(i) > mvlist.getScore(iBest)) {
+            iBest = i;
+        }
+    }
+    const Move mvBest {mvlist[iBest]};
+    const int scoreBest {mvlist.getScore(iBest)};
+    mvlist[iBest] = mvlist[idx];
+    mvlist.setScore(iBest, mvlist.getScore(idx));
+    mvlist[idx] = mvBest;
+    mvlist.setScore(idx, scoreBest);
+    return mvlist[idx++];
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef MOVEPICKER_INCLUDED
+#define MOVEPICKER_INCLUDED
+
+#include "chess_types.h"
+#include "bitboard.h"
+#include "move.h"
+
+#include <cstddef>
+
+// === movepicker.h ===
+// A staged, lazily-evaluated alternative to generateLegalMoves, for consumers
+// that usually stop after the first few moves (e.g. search).
+
+class Position;
+
+// === MovePicker ===
+// Yields the legal moves of a position one at a time, in stages:
+// 1. The hash move, if one is given and it is valid in the position.
+// 2. Captures (including en passant) and promotions, most valuable victim
+//    first, then least valuable attacker.
+// 3. Quiet moves, including castling.
+// Each stage is only generated once the previous one is used up, and moves
+// are only tested for legality as they are yielded. So a consumer that stops
+// after the hash move or a capture never generates the quiet moves.
+// The hash move is not yielded again by the later stages.
+//
+// Usage:
+//     MovePicker mp {pos, hashMove};
+//     for (Move mv = mp.next(); mv != NULL_MOVE; mv = mp.next()) {...}
+// Between calls to next(), the Position must be back in the same state (moves
+// made in between must have been unmade).
+
+class MovePicker {
+    public:
+        explicit MovePicker(Position& pos, Move hashMove = NULL_MOVE);
+        // Returns the next legal move, or NULL_MOVE once there are no more.
+        Move next();
+    
+    private:
+        enum Stage {
+            STAGE_HASH, STAGE_GEN_CAPTURES, STAGE_CAPTURES,
+            STAGE_GEN_QUIETS, STAGE_QUIETS, STAGE_DONE
+        };
+        
+        Position& pos;
+        const Move hashMove;
+        Stage stage {STAGE_HASH};
+        ScoredMovelist mvlist;
+        size_t idx {0};
+        // Worked out once, to restrict the moves generated.
+        const Colour co;
+        const Square ksq;
+        const Bitboard bbCheckers;
+        // Squares non-king moves must go to, to resolve a check (if any).
+        Bitboard bbEvasions {BB_ALL};
+        
+        void generateCaptures();
+        void generateQuiets();
+        Move pickBest();
+};
+
+#endif //#ifndef MOVEPICKER_INCLUDED
\ No newline at end of file
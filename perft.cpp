@@ -0,0 +1,362 @@
+#include "perft.h"
+
+#include "chess_types.h"
+#include "bitboard.h"
+#include "move.h"
+#include "movegen.h"
+#include "position.h"
+#include "zobrist.h"
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+uint64_t perft(int depth, Position& pos, bool isBulk) {
+    // Recursive function to count all legal moves (nodes) at depth n.
+    uint64_t nodes = 0;
+    // Terminating condition
+    if (depth == 0) {return 1;}
+    
+    Movelist mvlist = generateLegalMoves(pos);
+    int sz = mvlist.size();
+    // The moves are all legal, so each is exactly one leaf node.
+    if (depth == 1 && isBulk) {return sz;}
+    // Recurse.
+    for (int i = 0; i < sz; ++i) {
+        pos.makeMove(mvlist[i]);
+        uint64_t childN = perft(depth-1, pos, isBulk);
+        nodes += childN;
+        pos.unmakeMove(mvlist[i]);
+    }
+    return nodes;
+}
+
+// The probes and hits of one hashed perft call, added to the table's on return.
+struct PerftTableTally {
+    uint64_t probes {0};
+    uint64_t hits {0};
+};
+
+uint64_t perftHashed(int depth, Position& pos, PerftTable& table, bool isBulk,
+                     PerftTableTally& tally) {
+    // Depth 1 subtrees are cheaper to count than to look up, so skip those.
+    if (depth <= 1) {return perft(depth, pos, isBulk);}
+    uint64_t nodes {0};
+    ++tally.probes;
+    if (table.probe(pos.getKey(), depth, nodes)) {
+        ++tally.hits;
+        return nodes;
+    }
+    Movelist mvlist = generateLegalMoves(pos);
+    for (Move mv : mvlist) {
+        pos.makeMove(mv);
+        nodes += perftHashed(depth - 1, pos, table, isBulk, tally);
+        pos.unmakeMove(mv);
+    }
+    table.store(pos.getKey(), depth, nodes);
+    return nodes;
+}
+
+uint64_t perft(int depth, Position& pos, PerftTable& table, bool isBulk) {
+    // As perft(), but looks up and stores subtree counts in a table.
+    PerftTableTally tally;
+    const uint64_t nodes {perftHashed(depth, pos, table, isBulk, tally)};
+    table.addStats(tally.probes, tally.hits);
+    return nodes;
+}
+
+// === Perft to all depths ===
+void perftAllDepths(int depth, Position& pos, uint64_t* nodesByDepth,
+                    bool isBulk) {
+    // This node is at depth 0 of its subtree; its children at depth 1.
+    ++nodesByDepth[0];
+    if (depth == 0) {return;}
+    Movelist mvlist = generateLegalMoves(pos);
+    if (depth == 1 && isBulk) {
+        nodesByDepth[1] += mvlist.size();
+        return;
+    }
+    for (Move mv : mvlist) {
+        pos.makeMove(mv);
+        perftAllDepths(depth - 1, pos, nodesByDepth + 1, isBulk);
+        pos.unmakeMove(mv);
+    }
+    return;
+}
+
+
+// === Perft divide ===
+std::vector<PerftDivideEntry> perftDivide(int depth, Position& pos,
+                                          bool isBulk) {
+    std::vector<PerftDivideEntry> entries;
+    if (depth == 0) {return entries;}
+    Movelist mvlist = generateLegalMoves(pos);
+    for (Move mv : mvlist) {
+        pos.makeMove(mv);
+        entries.push_back({mv, perft(depth - 1, pos, isBulk)});
+        pos.unmakeMove(mv);
+    }
+    return entries;
+}
+
+
+// === EPD output ===
+size_t toPerftEpd(char* buf, size_t bufSize, const Position& pos,
+                  const PerftEpdEntry* entries, size_t numEntries) {
+    size_t len {pos.toFen(buf, bufSize)};
+    if (len == 0) {return 0;}
+    char* const last {buf + bufSize - 1}; // leaving room for the terminator
+    char* p {buf + len};
+    for (size_t i = 0; i < numEntries; ++i) {
+        if (last - p < 3) {return 0;}
+        *p++ = ' ';
+        *p++ = ';';
+        *p++ = 'D';
+        std::to_chars_result res {std::to_chars(p, last, entries[i].depth)};
+        if (res.ec != std::errc() || res.ptr == last) {return 0;}
+        p = res.ptr;
+        *p++ = ' ';
+        res = std::to_chars(p, last, entries[i].nodes);
+        if (res.ec != std::errc()) {return 0;}
+        p = res.ptr;
+    }
+    *p = '\0';
+    return static_cast<size_t>(p - buf);
+}
+
+
+// === Perft statistics ===
+void addLeafStats(Move mv, Position& pos, PerftStats& stats) {
+    // Classifies a (legal) move at the last ply, by making it.
+    const Square toSq {getToSq(mv)};
+    ++stats.nodes;
+    if (isEp(mv)) {
+        ++stats.captures;
+        ++stats.eps;
+    } else if (isCastling(mv)) {
+        ++stats.castles;
+    } else if (pos.getPiece(toSq) != NO_PIECE) {
+        ++stats.captures;
+    }
+    if (isPromotion(mv)) {
+        ++stats.promotions;
+    }
+    pos.makeMove(mv);
+    // Cached, so the generation of the replies below reuses it.
+    const Bitboard bbCheckers {pos.getCheckers()};
+    if (bbCheckers) {
+        ++stats.checks;
+        // Only checks not given by the moved unit itself (as counted in the
+        // published tables, a double check by both is not discovered).
+        // Castling moves two units, but only the rook can give check.
+        if (!isCastling(mv) && !(bbCheckers & toSq)) {
+            ++stats.discoveredChecks;
+        }
+        if (bbCheckers & (bbCheckers - 1)) {
+            ++stats.doubleChecks;
+        }
+    }
+    if (generateLegalMoves(pos).empty()) {
+        if (bbCheckers) {
+            ++stats.checkmates;
+        } else {
+            ++stats.stalemates;
+        }
+    }
+    pos.unmakeMove(mv);
+    return;
+}
+
+uint64_t perftStats(int depth, Position& pos, PerftStats& stats) {
+    if (depth == 0) {
+        ++stats.nodes;
+        return 1;
+    }
+    Movelist mvlist = generateLegalMoves(pos);
+    uint64_t nodes {0};
+    for (Move mv : mvlist) {
+        if (depth == 1) {
+            addLeafStats(mv, pos, stats);
+            ++nodes;
+            continue;
+        }
+        pos.makeMove(mv);
+        nodes += perftStats(depth - 1, pos, stats);
+        pos.unmakeMove(mv);
+    }
+    return nodes;
+}
+
+
+// === Parallel perft ===
+// A subtree to count: the moves leading to it from the root.
+constexpr int MAX_SPLIT_PLY {4};
+struct PerftTask {
+    std::array<Move, MAX_SPLIT_PLY> path {};
+    int pathLength {0};
+};
+
+// A worker's queue of tasks (indices into the task list). The owner takes
+// from the front; thieves take from the back.
+class PerftTaskQueue {
+    public:
+        void push(int iTask) {
+            std::lock_guard<std::mutex> lock {mtx};
+            tasks.push_back(iTask);
+        }
+        bool popFront(int& iTask) {
+            std::lock_guard<std::mutex> lock {mtx};
+            if (tasks.empty()) {return false;}
+            iTask = tasks.front();
+            tasks.pop_front();
+            return true;
+        }
+        bool popBack(int& iTask) {
+            std::lock_guard<std::mutex> lock {mtx};
+            if (tasks.empty()) {return false;}
+            iTask = tasks.back();
+            tasks.pop_back();
+            return true;
+        }
+    private:
+        std::mutex mtx;
+        std::deque<int> tasks;
+};
+
+std::vector<PerftTask> splitPerft(int depth, Position& pos, int minTasks) {
+    // Splits the tree one ply at a time until there are at least minTasks
+    // subtrees, leaving each at least one ply deep. Lines ending in mate or
+    // stalemate before then contribute no nodes, so are simply dropped.
+    std::vector<PerftTask> tasks(1);
+    int splitPly {0};
+    while (static_cast<int>(tasks.size()) < minTasks &&
+           splitPly < depth - 1 && splitPly < MAX_SPLIT_PLY) {
+        std::vector<PerftTask> children;
+        for (const PerftTask& task : tasks) {
+            for (int i = 0; i < task.pathLength; ++i) {
+                pos.makeMove(task.path[i]);
+            }
+            Movelist mvlist = generateLegalMoves(pos);
+            for (Move mv : mvlist) {
+                PerftTask child {task};
+                child.path[child.pathLength++] = mv;
+                children.push_back(child);
+            }
+            for (int i = task.pathLength - 1; i >= 0; --i) {
+                pos.unmakeMove(task.path[i]);
+            }
+        }
+        tasks.swap(children);
+        ++splitPly;
+    }
+    return tasks;
+}
+
+void perftWorker(int id, int depth, const Position& rootPos,
+                 const std::vector<PerftTask>& tasks,
+                 std::vector<PerftTaskQueue>& queues, PerftTable* table,
+                 bool isBulk, uint64_t& nodes) {
+    // Counts subtrees from its own queue, then steals from the others.
+    Position pos {rootPos};
+    const int numQueues {static_cast<int>(queues.size())};
+    int iTask {0};
+    nodes = 0;
+    while (true) {
+        bool isFound {queues[id].popFront(iTask)};
+        for (int i = 1; i < numQueues && !isFound; ++i) {
+            isFound = queues[(id + i) % numQueues].popBack(iTask);
+        }
+        if (!isFound) {
+            break; // Tasks are never added, so all work has been taken.
+        }
+        const PerftTask& task {tasks[iTask]};
+        for (int i = 0; i < task.pathLength; ++i) {
+            pos.makeMove(task.path[i]);
+        }
+        const int subDepth {depth - task.pathLength};
+        nodes += table ? perft(subDepth, pos, *table, isBulk)
+                       : perft(subDepth, pos, isBulk);
+        for (int i = task.pathLength - 1; i >= 0; --i) {
+            pos.unmakeMove(task.path[i]);
+        }
+    }
+    return;
+}
+
+uint64_t perftParallel(int depth, const Position& pos, int numThreads,
+                       PerftTable* table, bool isBulk) {
+    if (depth == 0) {return 1;}
+    if (numThreads < 1) {numThreads = 1;}
+    // Enough tasks per thread to even out unbalanced subtrees.
+    const int TASKS_PER_THREAD {16};
+    Position posSplit {pos};
+    const std::vector<PerftTask> tasks {
+        splitPerft(depth, posSplit, numThreads * TASKS_PER_THREAD)
+    };
+    // Deal tasks out in contiguous blocks, so thieves take from far away.
+    std::vector<PerftTaskQueue> queues(numThreads);
+    const int numTasks {static_cast<int>(tasks.size())};
+    for (int i = 0; i < numTasks; ++i) {
+        queues[static_cast<size_t>(i) * numThreads / numTasks].push(i);
+    }
+    std::vector<uint64_t> nodesByThread(numThreads, 0);
+    std::vector<std::thread> threads;
+    for (int id = 0; id < numThreads; ++id) {
+        threads.emplace_back(perftWorker, id, depth, std::cref(pos),
+                             std::cref(tasks), std::ref(queues), table,
+                             isBulk, std::ref(nodesByThread[id]));
+    }
+    uint64_t nodes {0};
+    for (int id = 0; id < numThreads; ++id) {
+        threads[id].join();
+        nodes += nodesByThread[id];
+    }
+    return nodes;
+}
+
+
+// === PerftTable ===
+PerftTable::PerftTable(size_t megabytes) {
+    size_t numEntries {1};
+    while (2 * numEntries * sizeof(Entry) <= megabytes * 1024 * 1024) {
+        numEntries *= 2;
+    }
+    entries.reset(new Entry[numEntries]);
+    mask = numEntries - 1;
+}
+
+bool PerftTable::probe(Key key, int depth, uint64_t& nodes) const {
+    const Entry& entry {entries[index(key, depth)]};
+    const uint64_t data {entry.data.load(std::memory_order_relaxed)};
+    const uint64_t keyXorData {entry.keyXorData.load(std::memory_order_relaxed)};
+    if ((keyXorData ^ data) != key || static_cast<int>(data >> 56) != depth) {
+        return false;
+    }
+    nodes = data & ((uint64_t{1} << 56) - 1);
+    return true;
+}
+
+void PerftTable::store(Key key, int depth, uint64_t nodes) {
+    // Node counts need at most 56 bits (up to depth ~11 from the start).
+    Entry& entry {entries[index(key, depth)]};
+    const uint64_t data {nodes | (static_cast<uint64_t>(depth) << 56)};
+    entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+    return;
+}
+
+void PerftTable::clear() {
+    for (size_t i = 0; i <= mask; ++i) {
+        entries[i].keyXorData.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+    numProbes = 0;
+    numHits = 0;
+    return;
+}
@@ -0,0 +1,136 @@
+#ifndef PERFT_INCLUDED
+#define PERFT_INCLUDED
+
+#include "move.h"
+#include "zobrist.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// === perft.h ===
+// Contains perft (performance test) functions, which count the leaf nodes of
+// the legal move tree of a position to a given depth. Used to validate move
+// generation against known results, and to measure its speed.
+
+class Position;
+
+// === PerftTable ===
+// A fixed-size, power-of-two transposition table of perft node counts, keyed
+// by Zobrist key and depth. Entries are always replaced on collision.
+// Each entry stores the key XORed with its data, so that a torn write (e.g.
+// from another thread) fails verification instead of returning wrong counts.
+// The table can be shared by threads: entries are relaxed atomics, which
+// compile to plain loads and stores on x86. Probes and hits are tallied by
+// each perft call in its own counters, and only added to the table's once it
+// returns, so threads sharing the table don't contend on them per probe.
+class PerftTable {
+    public:
+        // Takes the largest power-of-two number of entries fitting in size.
+        explicit PerftTable(size_t megabytes);
+        
+        bool probe(Key key, int depth, uint64_t& nodes) const;
+        void store(Key key, int depth, uint64_t nodes);
+        void clear();
+        
+        size_t getNumEntries() const {return mask + 1;}
+        // Statistics since construction or the last clear(), of the perft
+        // calls that have returned.
+        uint64_t getNumProbes() const {return numProbes;}
+        uint64_t getNumHits() const {return numHits;}
+        void addStats(uint64_t probes, uint64_t hits) {
+            numProbes.fetch_add(probes, std::memory_order_relaxed);
+            numHits.fetch_add(hits, std::memory_order_relaxed);
+        }
+    
+    private:
+        struct Entry {
+            std::atomic<uint64_t> keyXorData {0};
+            std::atomic<uint64_t> data {0}; // node count; depth in top 8 bits
+        };
+        std::unique_ptr<Entry[]> entries;
+        size_t mask {0};
+        std::atomic<uint64_t> numProbes {0};
+        std::atomic<uint64_t> numHits {0};
+        
+        size_t index(Key key, int depth) const {
+            // Mix in the depth so a position's entries at different depths
+            // don't evict each other.
+            return (key ^ (depth * 0x9E3779B97F4A7C15ULL)) & mask;
+        }
+};
+
+// === Bulk counting ===
+// With bulk counting (isBulk, the default), perft counts the nodes at depth 1
+// as the number of legal moves, without making and unmaking them. Pass false
+// to exercise makeMove/unmakeMove at the last ply too, e.g. when validating
+// changes to them. Every perft function below takes it, except perftStats,
+// which always makes the moves at the last ply.
+uint64_t perft(int depth, Position& pos, bool isBulk = true);
+uint64_t perft(int depth, Position& pos, PerftTable& table,
+               bool isBulk = true);
+
+// === Perft to all depths ===
+// Counts the nodes at every depth from 0 to depth in one walk of the tree,
+// adding the count at depth d to nodesByDepth[d]. So the shallower depths come
+// almost for free, instead of from separate perft runs. nodesByDepth must have
+// depth + 1 entries, zeroed by the caller.
+void perftAllDepths(int depth, Position& pos, uint64_t* nodesByDepth,
+                    bool isBulk = true);
+
+// === Perft divide ===
+// The node count of the subtree below each root move, in generation order.
+// Comparing these with a reference finds the root move whose subtree is
+// wrong; repeating from the position after it narrows the bug down further.
+struct PerftDivideEntry {
+    Move mv {NULL_MOVE};
+    uint64_t nodes {0};
+};
+std::vector<PerftDivideEntry> perftDivide(int depth, Position& pos,
+                                          bool isBulk = true);
+
+// === EPD output ===
+// Writes a line of a perft test suite, in the format tests/perft_tests reads:
+// "[FEN] ;D1 20 ;D2 400", one "D[depth] [nodes]" per entry, in order.
+// Null-terminated, with no newline. Returns its length, or 0 (writing nothing)
+// if buf is too small. Does not allocate, for exporting many positions.
+struct PerftEpdEntry {
+    int depth {0};
+    uint64_t nodes {0};
+};
+size_t toPerftEpd(char* buf, size_t bufSize, const Position& pos,
+                  const PerftEpdEntry* entries, size_t numEntries);
+
+// === Perft statistics ===
+// Counts of the kinds of move made at the last ply (the leaves), as in the
+// usual published perft tables. Discovered checks are checks the moved unit
+// doesn't give itself (so a double check including it isn't one, as there).
+// These come from a separate perft function rather than a runtime flag, so
+// plain perft has none of the extra work on its path.
+struct PerftStats {
+    uint64_t nodes {0};
+    uint64_t captures {0}; // including en passant
+    uint64_t eps {0};
+    uint64_t castles {0};
+    uint64_t promotions {0};
+    uint64_t checks {0};
+    uint64_t discoveredChecks {0};
+    uint64_t doubleChecks {0};
+    uint64_t checkmates {0};
+    uint64_t stalemates {0};
+};
+// Adds the statistics of the tree to depth to stats, and returns its nodes.
+uint64_t perftStats(int depth, Position& pos, PerftStats& stats);
+
+// === Parallel perft ===
+// Splits the tree into subtrees at the root, or a few plies deeper if the root
+// has too few moves to keep every thread busy. Each worker thread has its own
+// copy of the Position and its own queue of subtrees, and steals subtrees from
+// the back of other queues once its own is empty. The table (if any) is
+// shared by all threads.
+uint64_t perftParallel(int depth, const Position& pos, int numThreads,
+                       PerftTable* table = nullptr, bool isBulk = true);
+
+#endif //#ifndef PERFT_INCLUDED
\ No newline at end of file
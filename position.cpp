@@ -1,96 +1,180 @@
 #include "position.h"
 #include "chess_types.h"
 #include "bitboard.h"
+#include "bitboard_lookup.h"
 
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <sstream>
-#include <cctype>
+#include <string_view>
 #include <stdexcept>
+#include <system_error>
 
 void Position::reset() {
-    // Resets Position to default. (Might want to rewrite explicitly).
-    *this = Position(); // cheaty way out; calls default constructor!
+    // Resets Position to default (an empty board), field by field: copying
+    // in a default Position would also go through the undo stack.
+    bbByColour.fill(BB_NONE);
+    bbByType.fill(BB_NONE);
     mailbox.fill(NO_PIECE);
+    bbAll = BB_NONE;
+    sideToMove = WHITE;
+    castlingRights = NO_CASTLE;
+    epRights = NO_SQ;
+    fiftyMoveNum = 0;
+    halfmoveNum = 0;
+    key = 0;
+    undoStack.clear();
     return;
 }
 
+
+// === FEN parsing ===
+std::string toString(FenError err) {
+    switch (err) {
+        case FEN_OK: return "FEN OK.";
+        case FEN_BAD_BOARD: return "Bad piece placement in FEN.";
+        case FEN_BAD_SIDE: return "Unknown side to move in FEN.";
+        case FEN_BAD_CASTLING: return "Unknown castling rights in FEN.";
+        case FEN_BAD_EP: return "Unknown en passant rights in FEN.";
+        case FEN_BAD_COUNTER: return "Bad move counter in FEN.";
+        case FEN_EXTRA_FIELDS: return "Unexpected extra fields in FEN.";
+    }
+    return "Unknown FEN error.";
+}
+
+static bool isFenSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view nextFenField(std::string_view fen, size_t& idx) {
+    // Returns the next whitespace-delimited field (empty at the end).
+    while (idx < fen.size() && isFenSpace(fen[idx])) {++idx;}
+    const size_t start {idx};
+    while (idx < fen.size() && !isFenSpace(fen[idx])) {++idx;}
+    return fen.substr(start, idx - start);
+}
+
+static bool parseFenCounter(std::string_view field, int& n) {
+    // The whole field must be a non-negative integer.
+    const char* last {field.data() + field.size()};
+    const std::from_chars_result res {
+        std::from_chars(field.data(), last, n)
+    };
+    return res.ec == std::errc() && res.ptr == last && n >= 0;
+}
+
+FenError Position::parseFen(std::string_view fen) {
+    const FenError err {parseFenFields(fen)};
+    if (err != FEN_OK) {
+        reset();
+    }
+    return err;
+}
+
 Position& Position::fromFen(const std::string& fenStr) {
-    // Reads a FEN string and sets up the Position accordingly.
-    // TODO: Make it more robust in terms of accepting input.
-    std::istringstream fenSs(fenStr);
-    fenSs >> std::noskipws;
-    unsigned char token {0};
-    int isq {static_cast<int>(SQ_A8)};
-    size_t idx {std::string::npos};
-    
-    // Clear board.
+    const FenError err {parseFen(fenStr)};
+    if (err != FEN_OK) {
+        throw std::runtime_error(toString(err));
+    }
+    return *this;
+}
+
+FenError Position::parseFenFields(std::string_view fen) {
+    // Reads a FEN string straight into the Position's fields.
     reset();
-    // Read physical position
-    while ((fenSs >> token) && !isspace(token)) {
-        if (isdigit(token)) {
-            isq += static_cast<int>(token - '0'); // char '0' != int 0
-        } else if (token == '/') {
-            isq -= 8 + 8; // "square 9" of rank wraps up; must go down 2 ranks.
-        } else if ((idx = PIECE_CHARS.find(token)) != std::string::npos) {
-            addPiece(piece(idx), square(isq));
-            ++isq;
+    size_t idx {0};
+    
+    // Read physical position: ranks 8 to 1, each of exactly 8 squares.
+    int rank {7};
+    int file {0};
+    for (const char c : nextFenField(fen, idx)) {
+        if ('1' <= c && c <= '8') {
+            file += c - '0';
+            if (file > 8) {return FEN_BAD_BOARD;}
+        } else if (c == '/') {
+            if (file != 8 || rank == 0) {return FEN_BAD_BOARD;}
+            --rank;
+            file = 0;
         } else {
-            throw std::runtime_error("Unknown character in FEN position.");
+            const size_t ipc {PIECE_CHARS.find(c)};
+            if (ipc == std::string::npos || file > 7) {return FEN_BAD_BOARD;}
+            addPiece(static_cast<Piece>(ipc), static_cast<Square>(8*rank + file));
+            ++file;
         }
     }
-    // while loop ate 1 whitespace. Assume only 1 whitespace between blocks.
-    // Read side to move; assumes only 1 character.
-    if (fenSs >> token) {
-        switch (std::tolower(token)) {
-            case 'w': {sideToMove = WHITE; break;}
-            case 'b': {sideToMove = BLACK; break;}
-            default: {
-                throw std::runtime_error("Unknown side to move in FEN.");
-                break;
-            }
-        }
+    if (rank != 0 || file != 8) {return FEN_BAD_BOARD;}
+    
+    // Read side to move.
+    const std::string_view side {nextFenField(fen, idx)};
+    if (side == "w" || side == "W") {
+        sideToMove = WHITE;
+    } else if (side == "b" || side == "B") {
+        sideToMove = BLACK;
+    } else {
+        return FEN_BAD_SIDE;
     }
-    fenSs >> token; // Assumes (and eats) 1 whitespace.
+    
     // Read castling rights.
-    while ((fenSs >> token) && !isspace(token)) {
-        switch (token) {
-            case 'K': {castlingRights |= CASTLE_WSHORT; break;}
-            case 'Q': {castlingRights |= CASTLE_WLONG; break;}
-            case 'k': {castlingRights |= CASTLE_BSHORT; break;}
-            case 'q': {castlingRights |= CASTLE_BLONG; break;}
-            case '-': {castlingRights = NO_CASTLE; break;}
-            default: {
-                throw std::runtime_error("Unknown castling rights in FEN.");
+    const std::string_view castling {nextFenField(fen, idx)};
+    if (castling.empty()) {return FEN_BAD_CASTLING;}
+    if (castling != "-") {
+        for (const char c : castling) {
+            switch (c) {
+                case 'K': {castlingRights |= CASTLE_WSHORT; break;}
+                case 'Q': {castlingRights |= CASTLE_WLONG; break;}
+                case 'k': {castlingRights |= CASTLE_BSHORT; break;}
+                case 'q': {castlingRights |= CASTLE_BLONG; break;}
+                default: {return FEN_BAD_CASTLING;}
             }
         }
     }
-    // while loop ate 1 whitespace.
-    // Read en passant rights (one square).
-    while ((fenSs >> token) && !isspace(token)) {
-        if (token == '-') {epRights = NO_SQ; break;}
-        else if (('a' <= token) && (token <= 'h')) {
-            int x = static_cast<int>(token - 'a');
-            if ((fenSs >> token) && ('1' <= token) && (token <= '8')) {
-                int y = static_cast<int>(token - '1');
-                epRights = square(x, y);
-            }
-        } else {
-            throw std::runtime_error("Unknown en passant rights in FEN.");
-        }
+    
+    // Read en passant rights (one square, on the 3rd or 6th rank).
+    const std::string_view ep {nextFenField(fen, idx)};
+    if (ep.size() == 2 && 'a' <= ep[0] && ep[0] <= 'h' &&
+        (ep[1] == '3' || ep[1] == '6')) {
+        epRights = square(ep[0] - 'a', ep[1] - '1');
+    } else if (ep != "-") {
+        return FEN_BAD_EP;
     }
-    // while loop ate 1 whitespace.
-    // Read fifty-move and fullmove counters (assumes each is one integer)
+    
+    // Read fifty-move and fullmove counters, if present.
     int fullmoveNum {1};
-    fenSs >> std::skipws >> fiftyMoveNum >> fullmoveNum;
+    const std::string_view fifty {nextFenField(fen, idx)};
+    if (!fifty.empty()) {
+        if (!parseFenCounter(fifty, fiftyMoveNum)) {return FEN_BAD_COUNTER;}
+        const std::string_view fullmove {nextFenField(fen, idx)};
+        if (!fullmove.empty() && !parseFenCounter(fullmove, fullmoveNum)) {
+            return FEN_BAD_COUNTER;
+        }
+    }
+    if (!nextFenField(fen, idx).empty()) {return FEN_EXTRA_FIELDS;}
+    // Some FENs number the first move 0.
+    if (fullmoveNum < 1) {fullmoveNum = 1;}
     // Converting a fullmove number to halfmove number.
     // Halfmove 0 = Fullmove 1 + white to move.
     halfmoveNum = (sideToMove == WHITE) ? 2 * fullmoveNum - 2: 2 * fullmoveNum - 1;
+    key = computeKey();
     
-    return *this;
+    return FEN_OK;
 }
 
 
+void Position::makeMove(Move mv) {
+    // Dispatches once on the side to move, so that the choices depending on
+    // it are made at compile time.
+    if (sideToMove == WHITE) {
+        makeMove<WHITE>(mv);
+    } else {
+        makeMove<BLACK>(mv);
+    }
+    return;
+}
+
+template <Colour co>
 void Position::makeMove(Move mv) {
     // Makes a move by changing the state of Position.
     // Assumes the move is valid (not necessarily legal).
@@ -102,33 +186,46 @@ void Position::makeMove(Move mv) {
         return;
     }
     
+    // Direction of pawn pushes, and the mover's castling rights.
+    constexpr int PUSH {(co == WHITE) ? 8 : -8};
+    constexpr CastlingRights CR_OURS {(co == WHITE) ? CASTLE_WHITE
+                                                    : CASTLE_BLACK};
     const Square fromSq {getFromSq(mv)};
     const Square toSq {getToSq(mv)};
     const Piece pc {mailbox[fromSq]};
-    const Colour co {sideToMove}; // assert sideToMove == getPieceColour(pc);
+    // assert sideToMove == co == getPieceColour(pc);
     const PieceType pcty {getPieceType(pc)};
     
+    // Save irreversible state information in struct, *before* altering them.
+    const Piece pcDest {mailbox[toSq]};
+    undoStack.push(pcDest, castlingRights, epRights, fiftyMoveNum, key);
+    
     // Remove piece from fromSq
     bbByColour[co] ^= fromSq;
     bbByType[pcty] ^= fromSq;
+    bbAll ^= fromSq;
     mailbox[fromSq] = NO_PIECE;
+    key ^= ZOBRIST.pieceSq[pc][fromSq];
     
     // Handle regular captures and en passant separately
-    const Piece pcDest {mailbox[toSq]};
     const bool isCapture {pcDest != NO_PIECE};
     if (isCapture) {
         // Regular capture is occurring (not ep)
         PieceType pctyCap {getPieceType(pcDest)};
         bbByColour[!co] ^= toSq;
         bbByType[pctyCap] ^= toSq;
+        bbAll ^= toSq;
+        key ^= ZOBRIST.pieceSq[pcDest][toSq];
         // For atomic chess, explosion masking here.
     }
     if (isEp(mv)) {
         // ep capture is occurring, erase the captured pawn
-        Square sqEpCap {(co == WHITE) ? shiftS(toSq) : shiftN(toSq)};
+        const Square sqEpCap {square(toSq - PUSH)};
         bbByColour[!co] ^= sqEpCap;
         bbByType[PAWN] ^= sqEpCap;
+        bbAll ^= sqEpCap;
         mailbox[sqEpCap] = NO_PIECE;
+        key ^= ZOBRIST.pieceSq[piece(!co, PAWN)][sqEpCap];
         // No need to store captured piece; ep flag in the Move is sufficient.
     }
     // Place piece on toSq
@@ -142,22 +239,26 @@ void Position::makeMove(Move mv) {
         bbByType[pcty] ^= toSq;
         mailbox[toSq] = pc;
     }
-    // Save irreversible state information in struct, *before* altering them.
-    StateInfo undoState {pcDest, castlingRights, epRights, fiftyMoveNum};
-    undoStack.push_back(undoState);
+    bbAll ^= toSq;
+    key ^= ZOBRIST.pieceSq[mailbox[toSq]][toSq];
     
     // Update ep rights.
-    if ((pcty == PAWN) && (fromSq & BB_OUR_2[co]) && (toSq & BB_OUR_4[co])) {
-        epRights = square((fromSq + toSq) / 2); // average gives middle square
+    if (epRights != NO_SQ) {
+        key ^= ZOBRIST.epFile[getFileIdx(epRights)];
+    }
+    if ((pcty == PAWN) && (toSq == fromSq + 2 * PUSH)) {
+        epRights = square(fromSq + PUSH);
+        key ^= ZOBRIST.epFile[getFileIdx(epRights)];
     } else {
         epRights = NO_SQ;
     }
     // Update castling rights.
+    key ^= ZOBRIST.castling[castlingRights]; // rehashed once updated, below.
     // Castling rights are lost if the king moves.
     if ((pcty == KING) &&
         (fromSq == originalKingSquares[co * NUM_CASTLES / NUM_COLOURS])
        ) {
-        castlingRights &= (co == WHITE) ? ~CASTLE_WHITE : ~CASTLE_BLACK;
+        castlingRights &= ~CR_OURS;
     } else if (pcty == ROOK) {
         // Castling rights are lost on one side if that rook is moved.
         if (fromSq == originalRookSquares[toIndex(CASTLE_WSHORT)]) {
@@ -188,8 +289,10 @@ void Position::makeMove(Move mv) {
             castlingRights &= ~CASTLE_BLONG;
         }
     }
+    key ^= ZOBRIST.castling[castlingRights];
     // Change side to move, and update fifty-move and halfmove counts.
     sideToMove = !sideToMove;
+    key ^= ZOBRIST.blackToMove;
     if (isCapture || (pcty == PAWN)) {
         fiftyMoveNum = 0;
     } else {
@@ -200,6 +303,17 @@ void Position::makeMove(Move mv) {
 }
 
 
+void Position::unmakeMove(Move mv) {
+    // Dispatches once on the side that made the move (not the side to move).
+    if (sideToMove == WHITE) {
+        unmakeMove<BLACK>(mv);
+    } else {
+        unmakeMove<WHITE>(mv);
+    }
+    return;
+}
+
+template <Colour co>
 void Position::unmakeMove(Move mv) {
     // Unmakes (retracts) a move by changing the state of Position.
     // Assumes the move is valid (not necessarily legal).
@@ -211,21 +325,22 @@ void Position::unmakeMove(Move mv) {
         return;
     }
     
+    // Retractions are by the side without the move, co.
+    constexpr int PUSH {(co == WHITE) ? 8 : -8};
     const Square fromSq {getFromSq(mv)};
     const Square toSq {getToSq(mv)};
     const Piece pc {mailbox[toSq]};
-    const Colour co {!sideToMove}; // retractions are by the side without the move.
     const PieceType pcty {getPieceType(pc)};
     
     // Grab undo information off the stack. Assumes it matches the move called.
-    StateInfo undoState {undoStack.back()};
-    undoStack.pop_back();
+    const StateInfo& undoState {undoStack.pop()};
     
     // Revert side to move, castling and ep rights, fifty- and half-move counts.
-    sideToMove = !sideToMove;
+    sideToMove = co;
     castlingRights = undoState.castlingRights;
     epRights = undoState.epRights;
     fiftyMoveNum = undoState.fiftyMoveNum;
+    key = undoState.key;
     --halfmoveNum;
     
     // Put unit back on original square.
@@ -239,6 +354,7 @@ void Position::unmakeMove(Move mv) {
         bbByType[pcty] ^= toSq ^ fromSq;
         mailbox[fromSq] = pc;
     }
+    bbAll ^= toSq ^ fromSq;
     // mailbox[toSq] is set when attempting to replace captured piece (if any).
     
     // Put back captured piece, if any (en passant handled separately.)
@@ -246,20 +362,212 @@ void Position::unmakeMove(Move mv) {
     if (!(pcCap == NO_PIECE)) {
         bbByColour[getPieceColour(pcCap)] ^= toSq;
         bbByType[getPieceType(pcCap)] ^= toSq;
+        bbAll ^= toSq;
     }
     mailbox[toSq] = pcCap; // if en passant, then pcCap is NO_PIECE.
     
     // replace en passant captured pawn.
     if (isEp(mv)) {
-        Square sqEpCap {(co == WHITE) ? shiftS(toSq) : shiftN(toSq)};
+        const Square sqEpCap {square(toSq - PUSH)};
         bbByColour[!co] ^= sqEpCap;
         bbByType[PAWN] ^= sqEpCap;
+        bbAll ^= sqEpCap;
         mailbox[sqEpCap] = piece(!co, PAWN);
     }
     return;
 }
 
 
+// === FEN writing ===
+size_t Position::toFen(char* buf, size_t bufSize) const {
+    // Writes to a local buffer first, as only the length bounds it.
+    char fen[MAX_FEN_LENGTH];
+    char* p {fen};
+    // Write physical position, from the mailbox: ranks 8 to 1.
+    for (int rank = 7; rank >= 0; --rank) {
+        int numEmpty {0};
+        for (int file = 0; file < 8; ++file) {
+            const Piece pc {mailbox[8*rank + file]};
+            if (pc == NO_PIECE) {
+                ++numEmpty;
+                continue;
+            }
+            if (numEmpty > 0) {
+                *p++ = static_cast<char>('0' + numEmpty);
+                numEmpty = 0;
+            }
+            *p++ = PIECE_CHARS[pc];
+        }
+        if (numEmpty > 0) {*p++ = static_cast<char>('0' + numEmpty);}
+        if (rank > 0) {*p++ = '/';}
+    }
+    *p++ = ' ';
+    *p++ = (sideToMove == WHITE) ? 'w' : 'b';
+    *p++ = ' ';
+    if (castlingRights == NO_CASTLE) {
+        *p++ = '-';
+    } else {
+        for (int i = 0; i < NUM_CASTLES; ++i) {
+            if (castlingRights & CASTLE_LIST[i]) {*p++ = "KQkq"[i];}
+        }
+    }
+    *p++ = ' ';
+    if (epRights == NO_SQ) {
+        *p++ = '-';
+    } else {
+        *p++ = static_cast<char>('a' + getFileIdx(epRights));
+        *p++ = static_cast<char>('1' + getRankIdx(epRights));
+    }
+    // Write counters. Halfmove 0 = Fullmove 1 + white to move.
+    char* const last {fen + MAX_FEN_LENGTH - 1};
+    *p++ = ' ';
+    p = std::to_chars(p, last, fiftyMoveNum).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, last, halfmoveNum / 2 + 1).ptr;
+    
+    const size_t len {static_cast<size_t>(p - fen)};
+    if (len + 1 > bufSize) {return 0;}
+    std::memcpy(buf, fen, len);
+    buf[len] = '\0';
+    return len;
+}
+
+std::string Position::toFen() const {
+    char buf[MAX_FEN_LENGTH];
+    return std::string(buf, toFen(buf, MAX_FEN_LENGTH));
+}
+
+
+// === Packing ===
+bool Position::toPacked(PackedPosition& packed) const {
+    Bitboard bb {bbAll};
+    if (popCount(bb) > 32 || fiftyMoveNum > UINT16_MAX || halfmoveNum < 0) {
+        return false;
+    }
+    packed.occupancy = bb;
+    // Gathered in locals, not packed.pieces: read-modify-writes through memory
+    // would chain every unit on store forwarding.
+    std::array<uint64_t, 2> words {0, 0};
+    for (uint64_t& word : words) {
+        for (int shift = 0; shift < 64 && bb; shift += 4) {
+            word |= static_cast<uint64_t>(mailbox[popLsb(bb)]) << shift;
+        }
+    }
+    packed.pieces = words;
+    packed.flags = static_cast<uint8_t>(sideToMove | (castlingRights << 1));
+    packed.epSq = static_cast<uint8_t>(epRights);
+    packed.fiftyMoveNum = static_cast<uint16_t>(fiftyMoveNum);
+    packed.halfmoveNum = static_cast<uint32_t>(halfmoveNum);
+    return true;
+}
+
+bool Position::fromPacked(const PackedPosition& packed) {
+    const bool isOk {unpackFields(packed)};
+    if (!isOk) {
+        reset();
+    }
+    return isOk;
+}
+
+bool Position::unpackFields(const PackedPosition& packed) {
+    reset();
+    // Read physical position.
+    Bitboard bb {packed.occupancy};
+    const int numUnits {popCount(bb)};
+    if (numUnits > 32) {return false;}
+    for (uint64_t word : packed.pieces) {
+        for (int shift = 0; shift < 64 && bb; shift += 4) {
+            const int ipc {static_cast<int>((word >> shift) & 0xF)};
+            if (ipc >= NUM_PIECES) {return false;}
+            // As addPiece, with the colour and type found without checks.
+            const Square sq {popLsb(bb)};
+            bbByColour[ipc >= NUM_PIECE_TYPES] |= sq;
+            bbByType[ipc % NUM_PIECE_TYPES] |= sq;
+            mailbox[sq] = static_cast<Piece>(ipc);
+        }
+    }
+    bbAll = packed.occupancy;
+    // The bits after the last unit must be clear.
+    const int numBits {4 * numUnits};
+    if ((numBits < 64 && (packed.pieces[0] >> numBits)) ||
+        (numBits < 128 && (packed.pieces[1] >> std::max(numBits - 64, 0)))) {
+        return false;
+    }
+    for (Colour co : {WHITE, BLACK}) {
+        if (popCount(getUnitsBb(co, KING)) != 1) {return false;}
+    }
+    if (bbByType[PAWN] & (BB_1 | BB_8)) {return false;}
+    
+    // Read game state.
+    if (packed.flags >> 5) {return false;}
+    sideToMove = static_cast<Colour>(packed.flags & 1);
+    castlingRights = static_cast<CastlingRights>(packed.flags >> 1);
+    for (int i = 0; i < NUM_CASTLES; ++i) {
+        const CastlingRights cr {CASTLE_LIST[i]};
+        const Colour co {toColour(cr)};
+        if ((castlingRights & cr) &&
+            (mailbox[originalKingSquares[i]] != piece(co, KING) ||
+             mailbox[originalRookSquares[i]] != piece(co, ROOK))) {
+            return false;
+        }
+    }
+    if (packed.epSq != NO_SQ) {
+        // Behind an enemy pawn on our 5th rank, with the square empty.
+        if (packed.epSq > SQ_H8) {return false;}
+        epRights = static_cast<Square>(packed.epSq);
+        if (getRankIdx(epRights) != ((sideToMove == WHITE) ? 5 : 2)) {
+            return false;
+        }
+        const Square sqPawn {(sideToMove == WHITE) ? shiftS(epRights)
+                                                   : shiftN(epRights)};
+        if (mailbox[epRights] != NO_PIECE ||
+            mailbox[sqPawn] != piece(!sideToMove, PAWN)) {
+            return false;
+        }
+    }
+    fiftyMoveNum = packed.fiftyMoveNum;
+    if (packed.halfmoveNum > INT32_MAX ||
+        (packed.halfmoveNum & 1) != static_cast<uint32_t>(sideToMove)) {
+        return false;
+    }
+    halfmoveNum = static_cast<int>(packed.halfmoveNum);
+    key = computeKey();
+    return true;
+}
+
+bool unpackBoard(const PackedPosition& packed, PackedBoard& board) {
+    // The bitboards are built in locals, so that units of the same piece
+    // chain on registers rather than on stores to board.
+    Bitboard bb {packed.occupancy};
+    if (popCount(bb) > 32) {return false;}
+    std::array<Bitboard, NUM_PIECES> bbByPiece {};
+    Key key {0};
+    for (uint64_t word : packed.pieces) {
+        for (int shift = 0; shift < 64 && bb; shift += 4) {
+            const int ipc {static_cast<int>((word >> shift) & 0xF)};
+            if (ipc >= NUM_PIECES) {return false;}
+            const Square sq {popLsb(bb)};
+            bbByPiece[ipc] |= sq;
+            key ^= ZOBRIST.pieceSq[ipc][sq];
+        }
+    }
+    board.bbByPiece = bbByPiece;
+    board.sideToMove = static_cast<Colour>(packed.flags & 1);
+    board.castlingRights = static_cast<CastlingRights>((packed.flags >> 1) &
+                                                       CASTLE_ALL);
+    board.epSq = static_cast<Square>(packed.epSq);
+    key ^= ZOBRIST.castling[board.castlingRights];
+    if (board.epSq != NO_SQ) {
+        key ^= ZOBRIST.epFile[getFileIdx(board.epSq)];
+    }
+    if (board.sideToMove == BLACK) {
+        key ^= ZOBRIST.blackToMove;
+    }
+    board.key = key;
+    return true;
+}
+
+
 std::string Position::pretty() const {
     // Makes a human-readable string of the board represented by Position.
     std::array<Piece, NUM_SQUARES> posArr {};
@@ -328,11 +636,79 @@ void Position::addPiece(Piece pc, Square sq) {
     PieceType pcty {getPieceType(pc)};
     bbByColour[co] |= sq;
     bbByType[pcty] |= sq;
+    bbAll |= sq;
     mailbox[sq] = pc;
+    undoStack.clearCheckInfo();
     return;
 }
 
 
+Key Position::computeKey() const {
+    // Computes the Zobrist key of the position from scratch.
+    Key k {0};
+    for (Bitboard bb = bbAll; bb; ) {
+        const Square sq {popLsb(bb)};
+        k ^= ZOBRIST.pieceSq[mailbox[sq]][sq];
+    }
+    k ^= ZOBRIST.castling[castlingRights];
+    if (epRights != NO_SQ) {
+        k ^= ZOBRIST.epFile[getFileIdx(epRights)];
+    }
+    if (sideToMove == BLACK) {
+        k ^= ZOBRIST.blackToMove;
+    }
+    return k;
+}
+
+CheckInfo Position::computeCheckInfo() const {
+    // Kings are only missing from a Position being set up; their entries are
+    // then left empty.
+    CheckInfo ci {};
+    const Colour co {sideToMove};
+    const Bitboard bbDiagSliders {bbByType[BISHOP] | bbByType[QUEEN]};
+    const Bitboard bbOrthoSliders {bbByType[ROOK] | bbByType[QUEEN]};
+    for (Colour coKing : {WHITE, BLACK}) {
+        const Bitboard bbKing {getUnitsBb(coKing, KING)};
+        if (!bbKing) {continue;}
+        const Square ksq {lsb(bbKing)};
+        Bitboard bbSnipers {
+            ((bishopAttacks(ksq, BB_NONE) & bbDiagSliders) |
+             (rookAttacks(ksq, BB_NONE) & bbOrthoSliders)) &
+            bbByColour[!coKing]
+        };
+        while (bbSnipers) {
+            const Bitboard bbBetween {betweenMasks[ksq][popLsb(bbSnipers)] &
+                                      bbAll};
+            if (bbBetween && !(bbBetween & (bbBetween - 1))) {
+                ci.bbBlockers[coKing] |= bbBetween;
+            }
+        }
+    }
+    const Bitboard bbOurKing {getUnitsBb(co, KING)};
+    if (bbOurKing) {
+        // As attacksTo (movegen.h), which this file doesn't depend on.
+        const Square ksq {lsb(bbOurKing)};
+        ci.bbCheckers = bbByColour[!co] & (
+            (kingAttacks[ksq] & bbByType[KING]) |
+            (knightAttacks[ksq] & bbByType[KNIGHT]) |
+            (bishopAttacks(ksq, bbAll) & bbDiagSliders) |
+            (rookAttacks(ksq, bbAll) & bbOrthoSliders) |
+            (pawnAttacks[co][ksq] & bbByType[PAWN]));
+    }
+    const Bitboard bbTheirKing {getUnitsBb(!co, KING)};
+    if (bbTheirKing) {
+        const Square ksq {lsb(bbTheirKing)};
+        ci.bbCheckSquares[PAWN] = pawnAttacks[!co][ksq];
+        ci.bbCheckSquares[KNIGHT] = knightAttacks[ksq];
+        ci.bbCheckSquares[BISHOP] = bishopAttacks(ksq, bbAll);
+        ci.bbCheckSquares[ROOK] = rookAttacks(ksq, bbAll);
+        ci.bbCheckSquares[QUEEN] = ci.bbCheckSquares[BISHOP] |
+                                   ci.bbCheckSquares[ROOK];
+    }
+    return ci;
+}
+
+
 void Position::makeCastlingMove(Move mv) {
     // assert isCastling(mv);
     const Colour co {sideToMove};
@@ -364,20 +740,29 @@ void Position::makeCastlingMove(Move mv) {
     bbByColour[co] ^= (sqKFrom | sqRFrom | sqKTo | sqRTo);
     bbByType[KING] ^= (sqKFrom | sqKTo);
     bbByType[ROOK] ^= (sqRFrom | sqRTo);
+    bbAll ^= (sqKFrom | sqRFrom | sqKTo | sqRTo);
     mailbox[sqKFrom] = NO_PIECE;
     mailbox[sqRFrom] = NO_PIECE;
     mailbox[sqKTo] = piece(co, KING);
     mailbox[sqRTo] = piece(co, ROOK);
     
     // Save irreversible information in struct, *before* altering them.
-    const StateInfo undoState {NO_PIECE, castlingRights,
-                               epRights, fiftyMoveNum};
-    undoStack.push_back(undoState);
+    undoStack.push(NO_PIECE, castlingRights, epRights, fiftyMoveNum, key);
+    key ^= ZOBRIST.pieceSq[piece(co, KING)][sqKFrom] ^
+           ZOBRIST.pieceSq[piece(co, KING)][sqKTo] ^
+           ZOBRIST.pieceSq[piece(co, ROOK)][sqRFrom] ^
+           ZOBRIST.pieceSq[piece(co, ROOK)][sqRTo];
     // Update ep and castling rights.
+    if (epRights != NO_SQ) {
+        key ^= ZOBRIST.epFile[getFileIdx(epRights)];
+    }
     epRights = NO_SQ;
+    key ^= ZOBRIST.castling[castlingRights];
     castlingRights &= (co == WHITE) ? ~CASTLE_WHITE : ~CASTLE_BLACK;
+    key ^= ZOBRIST.castling[castlingRights];
     // Change side to move, and update fifty-move and halfmove counts.
     sideToMove = !sideToMove;
+    key ^= ZOBRIST.blackToMove;
     ++fiftyMoveNum;
     ++halfmoveNum;
     return;
@@ -413,20 +798,21 @@ void Position::unmakeCastlingMove(Move mv) {
         }
     }
     // Grab undo information off the stack. Assumes it matches the move called.
-    StateInfo undoState {undoStack.back()};
-    undoStack.pop_back();
+    const StateInfo& undoState {undoStack.pop()};
     
     // Revert side to move, castling and ep rights, fifty- and half-move counts.
     sideToMove = !sideToMove;
     castlingRights = undoState.castlingRights;
     epRights = undoState.epRights;
     fiftyMoveNum = undoState.fiftyMoveNum;
+    key = undoState.key;
     halfmoveNum--;
     
     // Put king and rook back on their original squares.
     bbByColour[co] ^= (sqKFrom | sqRFrom | sqKTo | sqRTo);
     bbByType[KING] ^= (sqKFrom | sqKTo);
     bbByType[ROOK] ^= (sqRFrom | sqRTo);
+    bbAll ^= (sqKFrom | sqRFrom | sqKTo | sqRTo);
     mailbox[sqKFrom] = piece(co, KING);
     mailbox[sqRFrom] = piece(co, ROOK);
     mailbox[sqKTo] = NO_PIECE;
@@ -4,26 +4,167 @@
 #include "chess_types.h"
 #include "bitboard.h"
 #include "move.h"
+#include "zobrist.h"
 
 #include <string>
+#include <string_view>
 #include <array>
-#include <deque>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 // === position.h ===
 // Defines the internal representation of a chess position.
 
 
+// === CheckInfo ===
+// Check-related bitboards of a position, worked out together on demand (see
+// Position::getCheckInfo).
+// - bbCheckers: the units checking the side to move.
+// - bbBlockers: for each colour, the units (of either colour) that are alone
+//   between that colour's king and an enemy slider. Those of the king's own
+//   colour are pinned; those of the other colour can give discovered check.
+// - bbCheckSquares: for each piece type, the squares from which a unit of
+//   that type of the side to move would check the enemy king (none for KING).
+// No member initialisers: value-initialise ({}) for an empty CheckInfo.
+struct CheckInfo {
+    Bitboard bbCheckers;
+    std::array<Bitboard, NUM_COLOURS> bbBlockers;
+    std::array<Bitboard, NUM_PIECE_TYPES> bbCheckSquares;
+};
+
 // === StateInfo ===
-// A struct for irreversible info about the position, for unmaking moves.
+// A struct for the irreversible info about the position at one ply, for
+// unmaking the move made from it, and its CheckInfo once worked out.
 struct StateInfo {
-    StateInfo() = default;
+    Piece capturedPiece; // by the move made from this ply
+    CastlingRights castlingRights;
+    Square epRights;
+    int fiftyMoveNum;
+    Key key;
+    CheckInfo checkInfo; // only if isCheckInfoSet
+    bool isCheckInfoSet;
+};
+
+// === UndoStack ===
+// A stack of StateInfo, one frame per ply since the Position was set up, the
+// last being the current position's. The frames are one block on the heap,
+// with room for UNDO_RESERVE_PLY plies to start with, that grows when a move
+// is made from its last frame. So any number of moves can be made, and once
+// a line has been played to its deepest ply, making and unmaking moves never
+// allocates. A copy allocates a block as big as the original's, but copies
+// only the live frames.
+// A push saves the current ply's irreversible state in its frame, and goes up
+// to a new frame with no CheckInfo. A pop goes back down to the frame of the
+// ply returned to, whose CheckInfo is still there, so unmaking a move
+// restores it without copying or recomputing it.
+constexpr size_t UNDO_RESERVE_PLY {256};
+
+class UndoStack {
+    public:
+        UndoStack() : sz {0} {
+            frames.reserve(UNDO_RESERVE_PLY);
+            frames.emplace_back();
+        }
+        UndoStack(const UndoStack& other) : sz {0} {
+            frames.reserve(other.frames.capacity());
+            *this = other;
+        }
+        UndoStack& operator=(const UndoStack& other) {
+            sz = other.sz;
+            frames.assign(other.frames.begin(),
+                          other.frames.begin() + other.sz + 1);
+            return *this;
+        }
+        
+        void push(Piece capturedPiece, CastlingRights castlingRights,
+                  Square epRights, int fiftyMoveNum, Key key) {
+            // Frames above the current one are kept on popping, so the stack
+            // only grows on going deeper than ever before.
+            if (sz + 1 == frames.size()) {frames.emplace_back();}
+            StateInfo& st {frames[sz]};
+            st.capturedPiece = capturedPiece;
+            st.castlingRights = castlingRights;
+            st.epRights = epRights;
+            st.fiftyMoveNum = fiftyMoveNum;
+            st.key = key;
+            frames[++sz].isCheckInfoSet = false;
+        }
+        // The frame stays valid until the next push.
+        const StateInfo& pop() {return frames[--sz];}
+        void clear() {
+            sz = 0;
+            frames[0].isCheckInfoSet = false;
+        }
+        
+        size_t size() const {return sz;}
+        bool empty() const {return sz == 0;}
+        
+        // The current ply's CheckInfo.
+        bool hasCheckInfo() const {return frames[sz].isCheckInfoSet;}
+        const CheckInfo& getCheckInfo() const {return frames[sz].checkInfo;}
+        void setCheckInfo(const CheckInfo& ci) {
+            frames[sz].checkInfo = ci;
+            frames[sz].isCheckInfoSet = true;
+        }
+        void clearCheckInfo() {frames[sz].isCheckInfoSet = false;}
     
-    Piece capturedPiece {NO_PIECE};
-    CastlingRights castlingRights {NO_CASTLE};
-    Square epRights {NO_SQ};
-    int fiftyMoveNum {0};
+    private:
+        std::vector<StateInfo> frames; // [0, sz] are live
+        size_t sz;
+};
+
+// The longest FEN toFen can write, plus the null terminator: a full board
+// (71 chars), " w KQkq e3" and two 10-digit counters.
+constexpr size_t MAX_FEN_LENGTH {104};
+
+// === FenError ===
+// Result of parsing a FEN string, naming the first field found to be bad.
+enum FenError : int {
+    FEN_OK, FEN_BAD_BOARD, FEN_BAD_SIDE, FEN_BAD_CASTLING, FEN_BAD_EP,
+    FEN_BAD_COUNTER, FEN_EXTRA_FIELDS
 };
 
+std::string toString(FenError err);
+
+// === PackedPosition ===
+// A position in 32 bytes, for bulk storage. All fields are fixed-size, but in
+// the machine's byte order.
+// - occupancy: the squares with a unit on them.
+// - pieces: the Piece on each occupied square in ascending square order, 4 bits
+//   each, 16 to a word from the low end. Unused bits are 0.
+// - flags: side to move (bit 0) and castling rights (bits 1-4).
+// - epSq: the en passant square, or NO_SQ.
+// - fiftyMoveNum, halfmoveNum: the counters.
+// So a position with more than 32 units can't be packed.
+struct PackedPosition {
+    uint64_t occupancy {0};
+    std::array<uint64_t, 2> pieces {};
+    uint8_t flags {0};
+    uint8_t epSq {NO_SQ};
+    uint16_t fiftyMoveNum {0};
+    uint32_t halfmoveNum {0};
+};
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must be 32 bytes");
+
+// === PackedBoard ===
+// The units and key of a PackedPosition, for bulk jobs that make no moves
+// (e.g. filtering a database by material or key). Decoding into one skips
+// what Position::fromPacked also sets up: the mailbox, the undo stack and
+// the checks on the record; bench measures both.
+struct PackedBoard {
+    std::array<Bitboard, NUM_PIECES> bbByPiece; // indexed by Piece
+    Colour sideToMove;
+    CastlingRights castlingRights;
+    Square epSq;
+    Key key; // as Position::getKey
+};
+
+// Returns false, leaving board unspecified, if a piece code is out of range
+// or there are more than 32 units. Nothing else is checked, so this is for
+// records known to be valid, e.g. written by toPacked.
+bool unpackBoard(const PackedPosition& packed, PackedBoard& board);
+
 // === Position class ===
 // It knows the:
 // - Piece location, in bitboard and mailbox form
@@ -32,6 +173,8 @@ struct StateInfo {
 // - En passant rights
 // - Fifty move counter
 // - Halfmove counter (halfmoves elapsed since start of game).
+// - Zobrist key (hash) of all the above except the counters, kept up to date
+//   incrementally by move making/unmaking.
 //
 // In addition, it can make/unmake Moves that are given to it, changing its
 // state accordingly.
@@ -41,7 +184,28 @@ class Position {
         Position() = default;
         void reset();
         // --- Initialise from FEN string ---
+        // Parses in place, without allocating or throwing, for bulk loading.
+        // Fields may be separated by any run of whitespace, and the two move
+        // counters may be left out (defaulting to 0 and 1). On error, the
+        // Position is left reset (empty).
+        FenError parseFen(std::string_view fen);
+        // As parseFen, but throws std::runtime_error on error.
         Position& fromFen(const std::string& fenStr);
+        // --- Write out as FEN string ---
+        // Writes the FEN, null-terminated, into buf without allocating.
+        // Returns its length, or 0 (writing nothing) if buf is too small.
+        size_t toFen(char* buf, size_t bufSize) const;
+        std::string toFen() const;
+        // --- Pack into / unpack from 32 bytes ---
+        // Returns false if the position can't be packed (more than 32 units,
+        // or counters out of range).
+        bool toPacked(PackedPosition& packed) const;
+        // Returns false for a malformed record, leaving the Position reset.
+        // Besides the format itself, it checks there is one king a side, no
+        // pawns on the 1st/8th ranks, castling rights only with the king and
+        // rook on their squares, an en passant square behind a pawn that just
+        // moved two squares, and a halfmove number matching the side to move.
+        bool fromPacked(const PackedPosition& packed);
         
         // --- Getters ---        
         Bitboard getUnitsBb(Colour co, PieceType pcty) const {
@@ -49,16 +213,43 @@ class Position {
         }
         Bitboard getUnitsBb(Colour co) const {return bbByColour[co];}
         Bitboard getUnitsBb(PieceType pcty) const {return bbByType[pcty];}
-        Bitboard getUnitsBb() const {
-            Bitboard bb {0};
-            for (int ico = 0; ico < NUM_COLOURS; ++ico) {bb |= bbByColour[ico];}
-            return bb;
-        }
+        Bitboard getUnitsBb() const {return bbAll;}
         std::array<Piece, NUM_SQUARES> getMailbox() const {return mailbox;}
+        Piece getPiece(Square sq) const {return mailbox[sq];}
         
         Colour getSideToMove() const {return sideToMove;}
         CastlingRights getCastlingRights() const {return castlingRights;}
         Square getEpSq() const {return epRights;}
+        Key getKey() const {return key;}
+        
+        // --- Check information ---
+        // Worked out on first use through a non-const Position, at most once
+        // per position, and kept with the undo state (see UndoStack), so
+        // unmaking a move restores it. Nothing const fills it in, so a const
+        // Position can still be shared between threads: findCheckInfo gives
+        // it only if already worked out, and computeCheckInfo works it out
+        // without keeping it.
+        const CheckInfo& getCheckInfo() {
+            if (!undoStack.hasCheckInfo()) {
+                undoStack.setCheckInfo(computeCheckInfo());
+            }
+            return undoStack.getCheckInfo();
+        }
+        Bitboard getCheckers() {return getCheckInfo().bbCheckers;}
+        Bitboard getPinned(Colour co) {
+            return getCheckInfo().bbBlockers[co] & bbByColour[co];
+        }
+        Bitboard getCheckSquares(PieceType pcty) {
+            return getCheckInfo().bbCheckSquares[pcty];
+        }
+        const CheckInfo* findCheckInfo() const {
+            return undoStack.hasCheckInfo() ? &undoStack.getCheckInfo()
+                                            : nullptr;
+        }
+        CheckInfo computeCheckInfo() const;
+        // Forgets the CheckInfo, so the next use works it out again. Never
+        // needed to keep it correct; for timing that work (as bench does).
+        void clearCheckInfo() {undoStack.clearCheckInfo();}
         
         // getters for info to execute castling
         // only to be called with "basic" castling rights K, Q, k, or q.
@@ -82,23 +273,26 @@ class Position {
         // --- Other ---
         // Turn position to printable string
         std::string pretty() const;
-        
-        
+    
+    
     private:
         // --- Class data members ---
         // Ensure state is updated correctly to maintain a valid Position!
         std::array<Bitboard, NUM_COLOURS> bbByColour {};
         std::array<Bitboard, NUM_PIECE_TYPES> bbByType {};
         std::array<Piece, NUM_SQUARES> mailbox {};
+        // Union of bbByColour, kept up to date with it.
+        Bitboard bbAll {BB_NONE};
         // Game state information
         Colour sideToMove {WHITE};
         CastlingRights castlingRights {NO_CASTLE};
         Square epRights {NO_SQ};
         int fiftyMoveNum {0};
         int halfmoveNum {0};
+        Key key {0};
         
         // Stack of unrestorable information for unmaking moves.
-        std::deque<StateInfo> undoStack {};
+        UndoStack undoStack;
         
         // --- Castling information ---
         // Information to help with validating/making castling moves.
@@ -128,6 +322,12 @@ class Position {
         
         // --- Helper methods ---
         void addPiece(Piece pc, Square sq);
+        FenError parseFenFields(std::string_view fen);
+        bool unpackFields(const PackedPosition& packed);
+        Key computeKey() const;
+        // makeMove/unmakeMove, for a mover known at compile time.
+        template <Colour co> void makeMove(Move mv);
+        template <Colour co> void unmakeMove(Move mv);
         void makeCastlingMove(Move mv);
         void unmakeCastlingMove(Move mv);
 };
@@ -142,8 +342,13 @@ inline bool operator==(const Position& lhs, const Position& rhs) {
     /// Note: Positions differing by an en passant capture which is pseudolegal
     /// but not legal due to e.g. a pin, are considered different here but
     /// identical under FIDE.
-    
-    // TODO: replace with zobrist hash or something
+    ///
+    /// Different Zobrist keys reject in O(1). Equal keys are confirmed by the
+    /// full comparison (this also checks the keys were updated correctly).
+    /// Where a 64-bit hash is trusted (caches etc.), compare getKey() instead.
+    if (lhs.getKey() != rhs.getKey()) {
+        return false;
+    }
     if (lhs.getMailbox() != rhs.getMailbox()) {
         return false;
     }
@@ -0,0 +1,185 @@
+#include "position_db.h"
+
+#include "position.h"
+#include "zobrist.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// === PositionDb ===
+bool PositionDb::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    HANDLE hFile {CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr)};
+    if (hFile == INVALID_HANDLE_VALUE) {return false;}
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0) {
+        CloseHandle(hFile);
+        return false;
+    }
+    HANDLE hMap {CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0,
+                                    nullptr)};
+    CloseHandle(hFile); // the mapping keeps the file open
+    if (!hMap) {return false;}
+    void* ptr {MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0)};
+    if (!ptr) {
+        CloseHandle(hMap);
+        return false;
+    }
+    mapHandle = hMap;
+    fileSize = static_cast<size_t>(size.QuadPart);
+#else
+    const int fd {::open(path.c_str(), O_RDONLY)};
+    if (fd < 0) {return false;}
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* ptr {mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0)};
+    ::close(fd); // the mapping keeps the file open
+    if (ptr == MAP_FAILED) {return false;}
+    fileSize = static_cast<size_t>(st.st_size);
+#endif
+    data = static_cast<const unsigned char*>(ptr);
+    if (!isValid()) {
+        close();
+        return false;
+    }
+    recordSize = sizeof(PackedPosition) + header().payloadSize;
+    return true;
+}
+
+void PositionDb::close() {
+    if (!data) {return;}
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mapHandle));
+#else
+    munmap(const_cast<unsigned char*>(data), fileSize);
+#endif
+    data = nullptr;
+    mapHandle = nullptr;
+    fileSize = 0;
+    recordSize = 0;
+    return;
+}
+
+bool PositionDb::isValid() const {
+    // Checks the header, and that the file is big enough for what it says.
+    // Each count is bounded by what fits in the file before it is multiplied
+    // or added to, so nothing can overflow.
+    const PositionDbHeader expected;
+    if (fileSize < sizeof(PositionDbHeader)) {return false;}
+    const PositionDbHeader& hdr {header()};
+    if (std::memcmp(hdr.magic, expected.magic, sizeof(hdr.magic)) != 0 ||
+        hdr.byteOrder != expected.byteOrder ||
+        hdr.version != expected.version) {
+        return false;
+    }
+    if (hdr.payloadSize % 8 != 0 || hdr.payloadSize > fileSize) {
+        return false;
+    }
+    const uint64_t recSize {sizeof(PackedPosition) + hdr.payloadSize};
+    if (hdr.numRecords > fileSize / recSize) {return false;}
+    const uint64_t recordsEnd {sizeof(PositionDbHeader) +
+                               hdr.numRecords * recSize};
+    if (recordsEnd > fileSize) {return false;}
+    if (hdr.indexOffset == 0) {return true;}
+    const uint64_t numSlots {hdr.numIndexSlots};
+    return hdr.indexOffset >= recordsEnd && hdr.indexOffset <= fileSize &&
+           hdr.indexOffset % 8 == 0 &&
+           numSlots > 0 && (numSlots & (numSlots - 1)) == 0 &&
+           numSlots <= (fileSize - hdr.indexOffset) / sizeof(PositionDbSlot);
+}
+
+size_t PositionDb::find(Key key) const {
+    if (!hasIndex()) {return size();}
+    const PositionDbSlot* slots {reinterpret_cast<const PositionDbSlot*>(
+        data + header().indexOffset)};
+    const uint64_t mask {header().numIndexSlots - 1};
+    // The writer leaves the index at most half full, so an empty slot ends
+    // a probe early; the probe count only bounds it for a damaged file.
+    uint64_t i {key & mask};
+    for (uint64_t n = 0; n <= mask && slots[i].recordIdx != 0; ++n) {
+        if (slots[i].key == key && slots[i].recordIdx <= size()) {
+            return slots[i].recordIdx - 1;
+        }
+        i = (i + 1) & mask;
+    }
+    return size();
+}
+
+std::pair<size_t, size_t> PositionDb::getPartition(size_t iPart,
+                                                   size_t numParts) const {
+    const size_t n {size()};
+    return {n * iPart / numParts, n * (iPart + 1) / numParts};
+}
+
+
+// === PositionDbWriter ===
+bool PositionDbWriter::open(const std::string& path, size_t payloadSize) {
+    if (payloadSize % 8 != 0) {return false;}
+    header = PositionDbHeader {};
+    header.payloadSize = payloadSize;
+    keys.clear();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    // The real header is written on finish().
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return file.good();
+}
+
+bool PositionDbWriter::add(const Position& pos, const void* payload) {
+    PackedPosition packed;
+    if (!pos.toPacked(packed)) {return false;}
+    file.write(reinterpret_cast<const char*>(&packed), sizeof(packed));
+    if (header.payloadSize > 0) {
+        file.write(static_cast<const char*>(payload), header.payloadSize);
+    }
+    keys.push_back(pos.getKey());
+    ++header.numRecords;
+    return file.good();
+}
+
+bool PositionDbWriter::finish(bool isIndexed) {
+    if (isIndexed) {
+        // At most half full; the first record with a key wins.
+        uint64_t numSlots {1};
+        while (numSlots < 2 * keys.size()) {numSlots *= 2;}
+        std::vector<PositionDbSlot> slots(numSlots);
+        const uint64_t mask {numSlots - 1};
+        for (size_t irec = 0; irec < keys.size(); ++irec) {
+            uint64_t i {keys[irec] & mask};
+            while (slots[i].recordIdx != 0 && slots[i].key != keys[irec]) {
+                i = (i + 1) & mask;
+            }
+            if (slots[i].recordIdx == 0) {
+                slots[i] = {keys[irec], irec + 1};
+            }
+        }
+        header.indexOffset = sizeof(PositionDbHeader) + header.numRecords *
+            (sizeof(PackedPosition) + header.payloadSize);
+        header.numIndexSlots = numSlots;
+        file.write(reinterpret_cast<const char*>(slots.data()),
+                   numSlots * sizeof(PositionDbSlot));
+    }
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    return !file.fail();
+}
\ No newline at end of file
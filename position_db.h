@@ -0,0 +1,125 @@
+#ifndef POSITION_DB_INCLUDED
+#define POSITION_DB_INCLUDED
+
+#include "position.h"
+#include "zobrist.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// === position_db.h ===
+// A read-only file of packed positions, memory-mapped for batch jobs, and a
+// writer to make one.
+//
+// File layout (all in the machine's byte order):
+// - A 64-byte PositionDbHeader.
+// - numRecords fixed-size records, from byte 64. Each is a PackedPosition,
+//   then payloadSize bytes for the user (e.g. expected perft counts), which
+//   the database doesn't look at. payloadSize is a multiple of 8, so every
+//   record stays 8-byte aligned.
+// - Optionally, a hash index from Zobrist key to record: numIndexSlots
+//   (a power of two) PositionDbSlots, linearly probed, from indexOffset.
+//
+// Records are read in place from the mapping (no copies), and decoded with
+// Position::fromPacked. The mapping is read-only, so any number of threads can
+// share one PositionDb, e.g. each taking one partition of the records; and
+// processes mapping the same file share the OS's cached pages.
+
+struct PositionDbHeader {
+    char magic[8] {'P', 'O', 'S', 'D', 'B', 0, 0, 0};
+    uint32_t byteOrder {0x01020304}; // reads differently on other machines
+    uint32_t version {1};
+    uint64_t numRecords {0};
+    uint64_t payloadSize {0};
+    uint64_t indexOffset {0}; // 0 if there is no index
+    uint64_t numIndexSlots {0};
+    uint64_t reserved[2] {};
+};
+static_assert(sizeof(PositionDbHeader) == 64, "header must be 64 bytes");
+
+struct PositionDbSlot {
+    Key key {0};
+    uint64_t recordIdx {0}; // plus one, so 0 marks an empty slot
+};
+
+// === PositionDb ===
+// Usage:
+//     PositionDb db;
+//     if (!db.open("positions.db")) {...}
+//     Position pos;
+//     for (size_t i = 0; i < db.size(); ++i) {
+//         if (db.decode(i, pos)) {... generateLegalMoves(pos) ...}
+//     }
+class PositionDb {
+    public:
+        PositionDb() = default;
+        ~PositionDb() {close();}
+        PositionDb(const PositionDb&) = delete;
+        PositionDb& operator=(const PositionDb&) = delete;
+        
+        // Maps the file. Returns false (leaving the db closed) if it can't be
+        // mapped, or its header or size is not that of a database.
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const {return data != nullptr;}
+        
+        size_t size() const {return data ? header().numRecords : 0;}
+        size_t getPayloadSize() const {return data ? header().payloadSize : 0;}
+        bool hasIndex() const {return data && header().indexOffset != 0;}
+        
+        // Record i, in place in the mapping. No bounds checking.
+        const PackedPosition& getPacked(size_t i) const {
+            return *reinterpret_cast<const PackedPosition*>(record(i));
+        }
+        const unsigned char* getPayload(size_t i) const {
+            return record(i) + sizeof(PackedPosition);
+        }
+        // Decodes record i into pos; false if the record is malformed.
+        bool decode(size_t i, Position& pos) const {
+            return pos.fromPacked(getPacked(i));
+        }
+        // The record of a position with this key, or size() if there is none
+        // (or no index).
+        size_t find(Key key) const;
+        // Records [first, second) of part iPart of numParts near-equal parts.
+        std::pair<size_t, size_t> getPartition(size_t iPart,
+                                               size_t numParts) const;
+    
+    private:
+        const unsigned char* data {nullptr};
+        size_t fileSize {0};
+        size_t recordSize {0};
+        void* mapHandle {nullptr}; // for unmapping on Windows
+        
+        const PositionDbHeader& header() const {
+            return *reinterpret_cast<const PositionDbHeader*>(data);
+        }
+        const unsigned char* record(size_t i) const {
+            return data + sizeof(PositionDbHeader) + i * recordSize;
+        }
+        bool isValid() const;
+};
+
+// === PositionDbWriter ===
+// Writes records to a new database file one at a time, then the index (if
+// asked for) and the header on finish(). Not thread-safe.
+class PositionDbWriter {
+    public:
+        // payloadSize must be a multiple of 8.
+        bool open(const std::string& path, size_t payloadSize);
+        // Returns false if the position can't be packed (it is not written).
+        // payload must point to payloadSize bytes (or be null if that is 0).
+        bool add(const Position& pos, const void* payload);
+        bool finish(bool isIndexed);
+    
+    private:
+        std::ofstream file;
+        PositionDbHeader header;
+        std::vector<Key> keys; // for the index
+};
+
+#endif //#ifndef POSITION_DB_INCLUDED
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "see.h"
+
+#include "chess_types.h"
+#include "bitboard.h"
+#include "bitboard_lookup.h"
+#include "move.h"
+#include "movegen.h"
+#include "position.h"
+
+#include <algorithm>
+#include <array>
+
+// === Exchange setup ===
+// What both functions start from: the move has been made on the target
+// square, and the attackers of the square are those left on the board.
+struct Exchange {
+    Square sq {NO_SQ};
+    Colour co {WHITE}; // the side to capture next
+    Bitboard bbOcc {BB_NONE};
+    Bitboard bbAttackers {BB_NONE}; // of both sides, still on the board
+    int gain {0}; // of the move itself
+    PieceType pctyOnSq {NO_PCTY}; // the unit there, to be captured next
+};
+
+static Exchange startExchange(Move mv, const Position& pos) {
+    Exchange ex;
+    const Square fromSq {getFromSq(mv)};
+    ex.sq = getToSq(mv);
+    ex.co = !pos.getSideToMove();
+    ex.bbOcc = pos.getUnitsBb() ^ fromSq;
+    ex.pctyOnSq = getPieceType(pos.getPiece(fromSq));
+    if (isEp(mv)) {
+        ex.gain = SEE_VALUES[PAWN];
+        ex.bbOcc ^= square(getFileIdx(ex.sq), getRankIdx(fromSq));
+    } else if (pos.getPiece(ex.sq) != NO_PIECE) {
+        ex.gain = SEE_VALUES[getPieceType(pos.getPiece(ex.sq))];
+    }
+    if (isPromotion(mv)) {
+        ex.pctyOnSq = getPromotionType(mv);
+        ex.gain += SEE_VALUES[ex.pctyOnSq] - SEE_VALUES[PAWN];
+    }
+    ex.bbAttackers = attacksTo(ex.sq, ex.bbOcc, pos) & ex.bbOcc;
+    return ex;
+}
+
+static PieceType nextAttacker(Exchange& ex, const Position& pos) {
+    // Finds the least valuable attacker of the side to capture, or NO_PCTY if
+    // it has none (or only a king, which can't capture into an attack).
+    // Otherwise removes it, adds the x-rays behind it, and passes the turn.
+    const Bitboard bbOurs {ex.bbAttackers & pos.getUnitsBb(ex.co)};
+    if (!bbOurs) {return NO_PCTY;}
+    PieceType pcty {PAWN};
+    Bitboard bb {bbOurs & pos.getUnitsBb(PAWN)};
+    while (!bb) {
+        pcty = static_cast<PieceType>(pcty + 1);
+        bb = bbOurs & pos.getUnitsBb(pcty);
+    }
+    if (pcty == KING && (ex.bbAttackers & pos.getUnitsBb(!ex.co))) {
+        return NO_PCTY;
+    }
+    ex.bbOcc ^= lsb(bb);
+    // Only a slider on the same line can be behind the unit removed.
+    if (pcty == PAWN || pcty == BISHOP || pcty == QUEEN) {
+        ex.bbAttackers |= bishopAttacks(ex.sq, ex.bbOcc) &
+                          (pos.getUnitsBb(BISHOP) | pos.getUnitsBb(QUEEN));
+    }
+    if (pcty == ROOK || pcty == QUEEN) {
+        ex.bbAttackers |= rookAttacks(ex.sq, ex.bbOcc) &
+                          (pos.getUnitsBb(ROOK) | pos.getUnitsBb(QUEEN));
+    }
+    ex.bbAttackers &= ex.bbOcc;
+    ex.co = !ex.co;
+    return pcty;
+}
+
+
+// === SEE ===
+int see(Move mv, const Position& pos) {
+    // Swap list: gains[d] is the material the side making capture d has won
+    // if the exchange stops after it. Then each side, from the last capture
+    // back, takes the better of stopping and capturing.
+    if (isCastling(mv)) {return 0;}
+    Exchange ex {startExchange(mv, pos)};
+    // At most one capture per unit left on the board.
+    std::array<int, 32> gains;
+    gains[0] = ex.gain;
+    int d {0};
+    PieceType pctyOnSq {ex.pctyOnSq};
+    for (PieceType pcty = nextAttacker(ex, pos); pcty != NO_PCTY;
+         pcty = nextAttacker(ex, pos)) {
+        ++d;
+        gains[d] = SEE_VALUES[pctyOnSq] - gains[d - 1];
+        pctyOnSq = pcty;
+    }
+    while (d > 0) {
+        gains[d - 1] = -std::max(-gains[d - 1], gains[d]);
+        --d;
+    }
+    return gains[0];
+}
+
+bool seeGE(Move mv, const Position& pos, int threshold) {
+    // No swap list: isGE is the answer if the exchange stops here, and swap
+    // is what the side to capture next must win, relative to the threshold,
+    // to change it. Once even losing the unit it captures with leaves that
+    // side its outcome, the rest of the exchange can't change the answer.
+    if (isCastling(mv)) {return 0 >= threshold;}
+    Exchange ex {startExchange(mv, pos)};
+    int swap {ex.gain - threshold};
+    if (swap < 0) {return false;}
+    swap = SEE_VALUES[ex.pctyOnSq] - swap;
+    if (swap <= 0) {return true;}
+    bool isGE {true};
+    for (PieceType pcty = nextAttacker(ex, pos); pcty != NO_PCTY;
+         pcty = nextAttacker(ex, pos)) {
+        isGE = !isGE;
+        swap = SEE_VALUES[pcty] - swap;
+        if (swap < static_cast<int>(isGE)) {break;}
+    }
+    return isGE;
+}
\ No newline at end of file
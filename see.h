@@ -0,0 +1,37 @@
+#ifndef SEE_INCLUDED
+#define SEE_INCLUDED
+
+#include "chess_types.h"
+#include "move.h"
+
+#include <array>
+
+// === see.h ===
+// Static exchange evaluation: the material a move wins or loses once the
+// units attacking its target square have captured back and forth there, each
+// side capturing with its least valuable unit and free to stop when it likes.
+// Units uncovered behind the capturing ones (x-rays) join in, as found from
+// the slider lookups with the units removed so far; no move is made.
+//
+// Like most SEEs, it looks at the target square only: pins, checks and
+// promotions by recapturing pawns are ignored. The one exception is that a
+// king never captures while the other side still has an attacker. Castling
+// is worth 0; en passant wins a pawn; a promotion wins the promoted piece
+// less the pawn, and puts that piece on the square.
+
+class Position;
+
+// Values of the piece types, indexed by PieceType. The king's value is never
+// used, as it is never captured.
+constexpr std::array<int, NUM_PIECE_TYPES> SEE_VALUES {
+    100, 300, 300, 500, 900, 0
+};
+
+// The exchange's value to the side to move, for a valid move (any move, not
+// only captures: a quiet move may put the unit where it can be taken).
+int see(Move mv, const Position& pos);
+// Whether see(mv, pos) >= threshold. Faster than see(), as it stops once the
+// answer is known (e.g. with threshold 0, to prune losing captures).
+bool seeGE(Move mv, const Position& pos, int threshold);
+
+#endif //#ifndef SEE_INCLUDED
\ No newline at end of file
@@ -0,0 +1,663 @@
+#include "bitboard_lookup.h"
+#include "check_batch.h"
+#include "movegen.h"
+#include "movegen_batch.h"
+#include "movepicker.h"
+#include "perft.h"
+#include "position.h"
+#include "see.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// === bench.cpp ===
+// Benchmark suite for the movegen, make/unmake, SEE and perft hot paths, and
+// the attack lookups they are built on. Each benchmark is run once to warm up,
+// then timed over a number of samples; the mean and standard deviation over
+// the samples are reported, in ns per operation or nodes per second.
+// With --csv the results are printed one per line, to compare between builds.
+// (Benchmark names contain no commas, so need no quoting.)
+// Every heap allocation goes through the replaced global operator new below,
+// so the allocations made while a benchmark runs can be counted.
+
+static uint64_t numAllocs {0};
+
+void* operator new(std::size_t sz) {
+    ++numAllocs;
+    if (void* ptr = std::malloc(sz ? sz : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept {std::free(ptr);}
+void operator delete(void* ptr, std::size_t) noexcept {std::free(ptr);}
+
+// Results of the benchmarked code are accumulated here (and printed), so that
+// the compiler can't optimise the code away.
+static uint64_t benchSink {0};
+
+// The fixed position set: the standard perft positions from the start, and
+// pawn-heavy middlegames (where pawn generation matters most).
+const std::vector<std::string> BENCH_FENS {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkb1r/pp3ppp/2np1n2/2p1p3/2P1P3/2NP1N2/PP3PPP/R1BQKB1R w KQkq - 0 1",
+    "r1bq1rk1/ppp2ppp/3p1n2/2b1p3/2BnP3/2NP1N2/PPP2PPP/R1BQ1RK1 w - - 0 1"
+};
+
+struct BenchOptions {
+    std::string epdFile; // empty for the fixed position set
+    int depth {4};
+    int numSamples {5};
+    bool isCsv {false};
+    int maxThreads {0}; // for the BatchMovegen rows; 0 for one per core
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit; // "ns/op" or "nodes/s" (or as set by the benchmark)
+    double mean {0};
+    double stddev {0};
+    int numSamples {0};
+    uint64_t allocs {0}; // per sample
+};
+
+
+std::vector<std::string> readFens(const std::string& epdFile) {
+    /// Reads the FEN part (up to the first ';') of each line of an EPD file.
+    std::vector<std::string> fens;
+    std::ifstream testSuite {epdFile};
+    std::string strLine;
+    while (std::getline(testSuite, strLine)) {
+        fens.push_back(strLine.substr(0, strLine.find(';')));
+    }
+    return fens;
+}
+
+std::vector<Position> setupPositions(const std::vector<std::string>& fens) {
+    std::vector<Position> positions(fens.size());
+    for (size_t i = 0; i < fens.size(); ++i) {
+        positions[i].fromFen(fens[i]);
+    }
+    return positions;
+}
+
+
+template <typename Body>
+BenchResult runBench(const std::string& name, const BenchOptions& opts,
+                     double opsPerRun, bool isRate, Body body) {
+    /// Runs body() once to warm up, then times it opts.numSamples times.
+    /// Each sample is converted to ns per op, or ops (nodes) per second if
+    /// isRate, given the number of ops in one run of body().
+    BenchResult res {name, isRate ? "nodes/s" : "ns/op"};
+    body();
+    std::vector<double> values;
+    values.reserve(opts.numSamples);
+    const uint64_t allocsBefore {numAllocs};
+    for (int isample = 0; isample < opts.numSamples; ++isample) {
+        const auto tStart = std::chrono::steady_clock::now();
+        body();
+        const double secs {std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - tStart).count()};
+        values.push_back(isRate ? opsPerRun / secs : 1e9 * secs / opsPerRun);
+    }
+    res.numSamples = opts.numSamples;
+    res.allocs = (numAllocs - allocsBefore) / opts.numSamples;
+    for (double v : values) {
+        res.mean += v / values.size();
+    }
+    if (values.size() > 1) {
+        double sumSq {0};
+        for (double v : values) {
+            sumSq += (v - res.mean) * (v - res.mean);
+        }
+        res.stddev = std::sqrt(sumSq / (values.size() - 1));
+    }
+    return res;
+}
+
+void printResult(const BenchResult& res, const BenchOptions& opts) {
+    if (opts.isCsv) {
+        std::cout << res.name << "," << res.unit << "," << res.mean << ","
+                  << res.stddev << "," << res.numSamples << "," << res.allocs
+                  << "\n";
+        return;
+    }
+    const double relStddev {res.mean > 0 ? 100 * res.stddev / res.mean : 0};
+    std::cout << std::left << std::setw(40) << res.name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(2)
+              << res.mean << " " << std::setw(7) << res.unit << "  +- "
+              << std::setprecision(1) << std::setw(4) << relStddev << "%"
+              << "  (" << res.allocs << " allocs)\n";
+    std::cout.unsetf(std::ios::fixed);
+    return;
+}
+
+
+// === Position benchmarks ===
+void benchPosition(const std::vector<std::string>& fens,
+                   const BenchOptions& opts) {
+    /// Times fromFen, parseFen and toFen, packing and unpacking (into a
+    /// Position, and into a PackedBoard), and a makeMove + unmakeMove pair
+    /// over every legal move.
+    const int numRepeats {2000};
+    Position pos;
+    printResult(runBench("fromFen", opts, numRepeats * fens.size(), false,
+        [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const std::string& fen : fens) {
+                    pos.fromFen(fen);
+                    benchSink += pos.getKey();
+                }
+            }
+        }), opts);
+    
+    // The same, with the error code instead of exceptions, as bulk loading
+    // would use it. Reported in millions of FENs per second.
+    BenchResult resParse {runBench("parseFen", opts,
+        numRepeats * fens.size(), true, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const std::string& fen : fens) {
+                    benchSink += pos.parseFen(fen);
+                    benchSink += pos.getKey();
+                }
+            }
+        })};
+    resParse.unit = "MFEN/s";
+    resParse.mean /= 1e6;
+    resParse.stddev /= 1e6;
+    printResult(resParse, opts);
+    
+    std::vector<Position> positions {setupPositions(fens)};
+    // Writing them back out, into a buffer as exporting would.
+    char buf[MAX_FEN_LENGTH];
+    BenchResult resWrite {runBench("toFen", opts,
+        numRepeats * positions.size(), true, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const Position& p : positions) {
+                    benchSink += p.toFen(buf, sizeof(buf));
+                    benchSink += buf[0];
+                }
+            }
+        })};
+    resWrite.unit = "MFEN/s";
+    resWrite.mean /= 1e6;
+    resWrite.stddev /= 1e6;
+    printResult(resWrite, opts);
+    
+    // Packing to 32 bytes and back, as bulk storage would.
+    std::vector<PackedPosition> packeds(positions.size());
+    BenchResult resPack {runBench("toPacked", opts,
+        numRepeats * positions.size(), true, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (size_t i = 0; i < positions.size(); ++i) {
+                    benchSink += positions[i].toPacked(packeds[i]);
+                    benchSink += packeds[i].pieces[0];
+                }
+            }
+        })};
+    Position posUnpacked;
+    BenchResult resUnpack {runBench("fromPacked", opts,
+        numRepeats * packeds.size(), true, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const PackedPosition& packed : packeds) {
+                    benchSink += posUnpacked.fromPacked(packed);
+                    benchSink += posUnpacked.getKey();
+                }
+            }
+        })};
+    PackedBoard board;
+    BenchResult resUnpackBoard {runBench("unpackBoard", opts,
+        numRepeats * packeds.size(), true, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const PackedPosition& packed : packeds) {
+                    benchSink += unpackBoard(packed, board);
+                    benchSink += board.key;
+                }
+            }
+        })};
+    for (BenchResult* res : {&resPack, &resUnpack, &resUnpackBoard}) {
+        res->unit = "Mpos/s";
+        res->mean /= 1e6;
+        res->stddev /= 1e6;
+        printResult(*res, opts);
+    }
+    
+    std::vector<Movelist> mvlists;
+    size_t numMoves {0};
+    for (Position& p : positions) {
+        mvlists.push_back(generateLegalMoves(p));
+        numMoves += mvlists.back().size();
+    }
+    printResult(runBench("makeMove+unmakeMove", opts, numRepeats * numMoves,
+        false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (size_t i = 0; i < positions.size(); ++i) {
+                    for (Move mv : mvlists[i]) {
+                        positions[i].makeMove(mv);
+                        benchSink += positions[i].getKey();
+                        positions[i].unmakeMove(mv);
+                    }
+                }
+            }
+        }), opts);
+    return;
+}
+
+
+// === Move generation benchmarks ===
+bool isCaptureOrPromotion(Move mv, const Position& pos) {
+    return isEp(mv) || isPromotion(mv) ||
+           (!isCastling(mv) && pos.getPiece(getToSq(mv)) != NO_PIECE);
+}
+
+void benchMovegen(const std::vector<std::string>& fens,
+                  const BenchOptions& opts) {
+    /// Times the legal move generators per position: all moves; captures,
+    /// by mode or by filtering all moves; and the first move of MovePicker,
+    /// as a search cutting off at once would see it, without and with a
+    /// (valid) hash move. BatchMovegen is timed per position too, on batches
+    /// of copies of the positions, on 1, 2, 4 ... --threads threads, with
+    /// its speedup over one thread.
+    /// The positions' CheckInfo is cleared before each generation, so it is
+    /// worked out afresh as in perft and the figures compare with builds
+    /// before it was kept in the Position. One row times generateLegalMoves
+    /// with it at hand (from the warm-up run on), for the split.
+    const int numRepeats {5000};
+    std::vector<Position> positions {setupPositions(fens)};
+    const double numOps {static_cast<double>(numRepeats) * positions.size()};
+    std::vector<Move> hashMoves;
+    for (Position& pos : positions) {
+        Movelist mvlist = generateLegalMoves(pos);
+        hashMoves.push_back(mvlist.empty() ? NULL_MOVE : mvlist.back());
+    }
+    
+    printResult(runBench("generateLegalMoves", opts, numOps, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (Position& pos : positions) {
+                pos.clearCheckInfo();
+                benchSink += generateLegalMoves(pos).size();
+            }
+        }
+    }), opts);
+    printResult(runBench("generateLegalMoves (CheckInfo at hand)", opts,
+        numOps, false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (Position& pos : positions) {
+                    benchSink += generateLegalMoves(pos).size();
+                }
+            }
+        }), opts);
+    const int numCopies {32};
+    std::vector<Position> batchPositions;
+    for (int icopy = 0; icopy < numCopies; ++icopy) {
+        batchPositions.insert(batchPositions.end(), positions.begin(),
+                              positions.end());
+    }
+    const int maxThreads {opts.maxThreads > 0 ? opts.maxThreads :
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()))};
+    std::vector<int> threadCounts;
+    for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+    BenchResult resOneThread;
+    for (int numThreads : threadCounts) {
+        BatchMovegen gen {numThreads};
+        MoveBatch batch;
+        const std::string strThreads {
+            std::to_string(numThreads) + (numThreads == 1 ? " thread"
+                                                          : " threads")
+        };
+        const BenchResult res {runBench("BatchMovegen (" + strThreads + ")",
+            opts, numOps, false, [&]() {
+                for (int irep = 0; irep < numRepeats / numCopies; ++irep) {
+                    for (Position& pos : batchPositions) {
+                        pos.clearCheckInfo();
+                    }
+                    gen.generate(batchPositions.data(), batchPositions.size(),
+                                 batch);
+                    benchSink += batch.moves.size();
+                }
+            })};
+        printResult(res, opts);
+        if (numThreads == 1) {
+            resOneThread = res;
+            continue;
+        }
+        // Speedup over one thread, with the samples' relative errors added
+        // in quadrature.
+        BenchResult resSpeedup {res};
+        resSpeedup.name = "BatchMovegen speedup (" + strThreads + ")";
+        resSpeedup.unit = "x";
+        resSpeedup.mean = resOneThread.mean / res.mean;
+        resSpeedup.stddev = resSpeedup.mean * std::hypot(
+            resOneThread.stddev / resOneThread.mean, res.stddev / res.mean);
+        printResult(resSpeedup, opts);
+    }
+    printResult(runBench("generateLegalMoves GEN_CAPTURES", opts, numOps,
+        false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (Position& pos : positions) {
+                    pos.clearCheckInfo();
+                    benchSink += generateLegalMoves(pos, GEN_CAPTURES).size();
+                }
+            }
+        }), opts);
+    printResult(runBench("generateLegalMoves (filter captures)", opts, numOps,
+        false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (Position& pos : positions) {
+                    pos.clearCheckInfo();
+                    for (Move mv : generateLegalMoves(pos)) {
+                        benchSink += isCaptureOrPromotion(mv, pos);
+                    }
+                }
+            }
+        }), opts);
+    printResult(runBench("MovePicker first move", opts, numOps, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (Position& pos : positions) {
+                pos.clearCheckInfo();
+                MovePicker mp {pos};
+                benchSink += mp.next();
+            }
+        }
+    }), opts);
+    printResult(runBench("MovePicker first move (hash move)", opts, numOps,
+        false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (size_t i = 0; i < positions.size(); ++i) {
+                    positions[i].clearCheckInfo();
+                    MovePicker mp {positions[i], hashMoves[i]};
+                    benchSink += mp.next();
+                }
+            }
+        }), opts);
+    return;
+}
+
+
+// === Attack benchmarks ===
+void benchAttacks(const std::vector<std::string>& fens,
+                  const BenchOptions& opts) {
+    /// Times attacksTo and isAttacked on every square by both sides, and
+    /// castling validation (isAttacked-heavy) for every castling right.
+    /// Then times in-check tests of the side to move over the positions
+    /// after every legal move: isInCheck on each, and the check kernels on a
+    /// CheckBatch of them (as filled in advance, and including filling it).
+    const int numRepeats {500};
+    std::vector<Position> positions {setupPositions(fens)};
+    const double numSquareOps {
+        2.0 * NUM_SQUARES * numRepeats * positions.size()
+    };
+    printResult(runBench("attacksTo", opts, numSquareOps, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (const Position& pos : positions) {
+                for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+                    benchSink += attacksTo(square(isq), WHITE, pos);
+                    benchSink += attacksTo(square(isq), BLACK, pos);
+                }
+            }
+        }
+    }), opts);
+    printResult(runBench("isAttacked", opts, numSquareOps, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (const Position& pos : positions) {
+                for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+                    benchSink += isAttacked(square(isq), WHITE, pos);
+                    benchSink += isAttacked(square(isq), BLACK, pos);
+                }
+            }
+        }
+    }), opts);
+    printResult(runBench("isCastlingValid", opts,
+        static_cast<double>(NUM_CASTLES) * numRepeats * positions.size(),
+        false, [&]() {
+            for (int irep = 0; irep < numRepeats; ++irep) {
+                for (const Position& pos : positions) {
+                    for (CastlingRights cr : CASTLE_LIST) {
+                        benchSink += isCastlingValid(cr, pos);
+                    }
+                }
+            }
+        }), opts);
+    
+    std::vector<Position> children;
+    for (Position& pos : positions) {
+        for (Move mv : generateLegalMoves(pos)) {
+            pos.makeMove(mv);
+            children.push_back(pos);
+            pos.unmakeMove(mv);
+        }
+    }
+    CheckBatch batch;
+    for (const Position& pos : children) {
+        batch.add(pos, pos.getSideToMove());
+    }
+    std::vector<Bitboard> bbCheckers(batch.size());
+    const int numCheckRepeats {20 * numRepeats};
+    const double numChecks {static_cast<double>(numCheckRepeats) *
+                            children.size()};
+    printResult(runBench("isInCheck", opts, numChecks, false, [&]() {
+        for (int irep = 0; irep < numCheckRepeats; ++irep) {
+            for (const Position& pos : children) {
+                benchSink += isInCheck(pos.getSideToMove(), pos);
+            }
+        }
+    }), opts);
+    const CheckKernel ckDetected {getCheckKernel()};
+    const char* const KERNEL_NAMES[] {"scalar", "AVX2", "AVX-512"};
+    for (CheckKernel ck : {CHECK_SCALAR, CHECK_AVX2, CHECK_AVX512}) {
+        if (!setCheckKernel(ck)) {continue;}
+        printResult(runBench(std::string {"findCheckers ("} +
+                             KERNEL_NAMES[ck] + ")", opts, numChecks, false,
+            [&]() {
+                for (int irep = 0; irep < numCheckRepeats; ++irep) {
+                    findCheckers(batch, bbCheckers.data());
+                    benchSink += bbCheckers[irep % bbCheckers.size()];
+                }
+            }), opts);
+    }
+    setCheckKernel(ckDetected);
+    printResult(runBench(std::string {"CheckBatch::add+findCheckers ("} +
+                         KERNEL_NAMES[ckDetected] + ")", opts, numChecks,
+        false, [&]() {
+            for (int irep = 0; irep < numCheckRepeats; ++irep) {
+                batch.clear();
+                for (const Position& pos : children) {
+                    batch.add(pos, pos.getSideToMove());
+                }
+                findCheckers(batch, bbCheckers.data());
+                benchSink += bbCheckers[irep % bbCheckers.size()];
+            }
+        }), opts);
+    return;
+}
+
+// === SEE benchmarks ===
+void benchSee(const std::vector<std::string>& fens, const BenchOptions& opts) {
+    /// Times see and seeGE (at 0, as when pruning losing captures) on every
+    /// capture and promotion of the positions after every legal move.
+    const int numRepeats {200};
+    std::vector<Position> positions {setupPositions(fens)};
+    std::vector<Position> children;
+    for (Position& pos : positions) {
+        for (Move mv : generateLegalMoves(pos)) {
+            pos.makeMove(mv);
+            children.push_back(pos);
+            pos.unmakeMove(mv);
+        }
+    }
+    std::vector<std::pair<size_t, Move>> captures;
+    for (size_t i = 0; i < children.size(); ++i) {
+        for (Move mv : generateLegalMoves(children[i], GEN_CAPTURES)) {
+            captures.emplace_back(i, mv);
+        }
+    }
+    const double numCalls {static_cast<double>(numRepeats) * captures.size()};
+    printResult(runBench("see", opts, numCalls, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (const std::pair<size_t, Move>& capture : captures) {
+                benchSink += see(capture.second, children[capture.first]);
+            }
+        }
+    }), opts);
+    printResult(runBench("seeGE", opts, numCalls, false, [&]() {
+        for (int irep = 0; irep < numRepeats; ++irep) {
+            for (const std::pair<size_t, Move>& capture : captures) {
+                benchSink += seeGE(capture.second, children[capture.first], 0);
+            }
+        }
+    }), opts);
+    return;
+}
+
+template <Bitboard (*findAttacks)(Square, Bitboard)>
+void benchLookup(const std::string& name, const std::vector<Square>& squares,
+                 const std::vector<Bitboard>& occupancies,
+                 const BenchOptions& opts) {
+    /// Times one lookup per (square, occupancy) sample. The getter is a
+    /// template argument, so it is inlined as in movegen. Each lookup depends
+    /// on the last, so latency (as in a serial slider loop) is measured.
+    printResult(runBench(name, opts, squares.size(), false, [&]() {
+        Bitboard bbLast {BB_NONE};
+        for (size_t i = 0; i < squares.size(); ++i) {
+            bbLast = findAttacks(squares[i], occupancies[i] ^ (bbLast & 1));
+        }
+        benchSink += bbLast;
+    }), opts);
+    return;
+}
+
+void benchLookups(const BenchOptions& opts) {
+    /// Times the line and slider attack getters (of every backend) on random
+    /// squares and occupancies.
+    std::vector<Square> squares;
+    std::vector<Bitboard> occupancies;
+    uint64_t seed {0x9E3779B97F4A7C15ULL};
+    for (int i = 0; i < (1 << 18); ++i) {
+        // xorshift; ANDing two outputs gives a more realistic density.
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        squares.push_back(square(static_cast<int>(seed & 63)));
+        Bitboard bbOcc {seed};
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        occupancies.push_back(bbOcc & seed);
+    }
+    benchLookup<findRankAttacks>("findRankAttacks", squares, occupancies, opts);
+    benchLookup<findFileAttacks>("findFileAttacks", squares, occupancies, opts);
+    benchLookup<findDiagAttacks>("findDiagAttacks", squares, occupancies, opts);
+    benchLookup<findAntidiagAttacks>("findAntidiagAttacks", squares,
+                                     occupancies, opts);
+    benchLookup<bishopAttacksKindergarten>("bishopAttacksKindergarten",
+                                           squares, occupancies, opts);
+    benchLookup<rookAttacksKindergarten>("rookAttacksKindergarten",
+                                         squares, occupancies, opts);
+    benchLookup<bishopAttacksMagic>("bishopAttacksMagic", squares,
+                                    occupancies, opts);
+    benchLookup<rookAttacksMagic>("rookAttacksMagic", squares, occupancies,
+                                  opts);
+    if (isSliderBackendSupported(PEXT)) {
+        benchLookup<bishopAttacksPext>("bishopAttacksPext", squares,
+                                       occupancies, opts);
+        benchLookup<rookAttacksPext>("rookAttacksPext", squares, occupancies,
+                                     opts);
+    }
+    benchLookup<bishopAttacks>("bishopAttacks (selected backend)", squares,
+                               occupancies, opts);
+    benchLookup<rookAttacks>("rookAttacks (selected backend)", squares,
+                             occupancies, opts);
+    return;
+}
+
+
+// === Perft benchmarks ===
+void benchPerft(const std::vector<std::string>& fens,
+                const BenchOptions& opts) {
+    /// Times perft to opts.depth on every position, with bulk counting and
+    /// with make/unmake at the leaves.
+    std::vector<Position> positions {setupPositions(fens)};
+    uint64_t nodes {0};
+    for (Position& pos : positions) {
+        nodes += perft(opts.depth, pos);
+    }
+    const std::string strDepth {"perft depth " + std::to_string(opts.depth)};
+    for (bool isBulk : {true, false}) {
+        printResult(runBench(strDepth + (isBulk ? " (bulk counting)"
+                                                : " (make/unmake leaves)"),
+            opts, nodes, true, [&]() {
+                for (Position& pos : positions) {
+                    benchSink += perft(opts.depth, pos, isBulk);
+                }
+            }), opts);
+    }
+    return;
+}
+
+
+int main(int argc, char* argv[]) {
+    BenchOptions opts;
+    for (int iarg = 1; iarg < argc; ++iarg) {
+        std::string strArg {argv[iarg]};
+        if (strArg == "--epd" && iarg + 1 < argc) {
+            opts.epdFile = argv[++iarg];
+        } else if (strArg == "--depth" && iarg + 1 < argc) {
+            opts.depth = std::atoi(argv[++iarg]);
+        } else if (strArg == "--samples" && iarg + 1 < argc) {
+            opts.numSamples = std::atoi(argv[++iarg]);
+        } else if (strArg == "--csv") {
+            opts.isCsv = true;
+        } else if (strArg == "--threads" && iarg + 1 < argc) {
+            opts.maxThreads = std::atoi(argv[++iarg]);
+        } else {
+            std::cout << "Run the benchmarks with the command [filename] "
+                "[options]. Options:\n"
+                "  --epd [EPD file path]  positions to use, instead of the "
+                "fixed set\n"
+                "  --depth [N]    perft depth (default 4)\n"
+                "  --samples [N]  timed samples per benchmark (default 5)\n"
+                "  --csv          print results as CSV\n"
+                "  --threads [N]  time BatchMovegen on 1, 2, 4 ... N threads, "
+                "with the speedup\n"
+                "                 over 1 (default N: one per core)\n";
+            return 0;
+        }
+    }
+    if (opts.numSamples < 1) {opts.numSamples = 1;}
+    const std::vector<std::string> fens {
+        opts.epdFile.empty() ? BENCH_FENS : readFens(opts.epdFile)
+    };
+    
+    if (opts.isCsv) {
+        std::cout << "name,unit,mean,stddev,samples,allocs\n";
+    } else {
+        std::cout << "Slider backend: " << getSliderBackend() << ", "
+                  << fens.size() << " positions, " << opts.numSamples
+                  << " samples per benchmark.\n";
+    }
+    benchPosition(fens, opts);
+    benchMovegen(fens, opts);
+    benchAttacks(fens, opts);
+    benchSee(fens, opts);
+    benchLookups(opts);
+    benchPerft(fens, opts);
+    if (!opts.isCsv) {
+        std::cout << "(checksum " << (benchSink & 0xffff) << ")\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "check_batch.h"
+#include "epd_suite.h"
+#include "movegen.h"
+#include "position.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct CheckPerft {
+    /// What perftChecks keeps between batches.
+    CheckBatch batch;
+    std::vector<Bitboard> bbExpected; // by attacksTo
+    std::vector<Bitboard> bbCheckers;
+    bool isMismatch {false};
+};
+
+void flushChecks(CheckPerft& cp) {
+    /// Runs every supported check kernel on the batch, then empties it.
+    const CheckKernel ckDetected {getCheckKernel()};
+    cp.bbCheckers.resize(cp.batch.size());
+    for (CheckKernel ck : {CHECK_SCALAR, CHECK_AVX2, CHECK_AVX512}) {
+        if (!setCheckKernel(ck)) {continue;}
+        findCheckers(cp.batch, cp.bbCheckers.data());
+        if (cp.bbCheckers != cp.bbExpected) {
+            cp.isMismatch = true;
+        }
+    }
+    setCheckKernel(ckDetected);
+    cp.batch.clear();
+    cp.bbExpected.clear();
+    return;
+}
+
+uint64_t perftChecks(int depth, Position& pos, CheckPerft& cp) {
+    /// Perft, also finding the checkers of both kings at every node with the
+    /// check kernels, in batches, to compare with attacksTo. Batches are
+    /// flushed at 1002 entries, so the vector kernels leave a scalar tail.
+    for (Colour co : {WHITE, BLACK}) {
+        cp.batch.add(pos, co);
+        const Square ksq {lsb(pos.getUnitsBb(co, KING))};
+        cp.bbExpected.push_back(attacksTo(ksq, !co, pos));
+    }
+    if (cp.batch.size() > 1000) {
+        flushChecks(cp);
+    }
+    if (depth == 0) {return 1;}
+    Movelist mvlist = generateLegalMoves(pos);
+    uint64_t nodes {0};
+    for (Move mv : mvlist) {
+        pos.makeMove(mv);
+        nodes += perftChecks(depth - 1, pos, cp);
+        pos.unmakeMove(mv);
+    }
+    return nodes;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cout << "Run the check kernel tests with the command [filename] "
+            "[EPD file path] [Maximum depth] (all arguments required).\n"
+            "Counts perft, finding both kings' checkers at every node with "
+            "each supported\n"
+            "check kernel.\n";
+        return 0;
+    }
+    std::string epdFile {argv[1]};
+    int maxDepth {std::atoi(argv[2])};
+    int numTests = 0;
+    std::vector<int> idFails;
+    runEpdSuite(epdFile, maxDepth, [](int depth, Position& pos) {
+        CheckPerft cp;
+        const uint64_t nodes {perftChecks(depth, pos, cp)};
+        flushChecks(cp);
+        return cp.isMismatch ? 0 : nodes;
+    }, numTests, idFails);
+    printSummary(numTests, idFails);
+    return 0;
+}
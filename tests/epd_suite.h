@@ -0,0 +1,115 @@
+#ifndef EPD_SUITE_INCLUDED
+#define EPD_SUITE_INCLUDED
+
+#include "position.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// === epd_suite.h ===
+// What the test drivers share: reading a perft suite in EPD, checking some
+// way of counting nodes against it, and printing the summary.
+
+struct EpdTest {
+    /// A single test (position) from a single line in EPD.
+    std::string strFen;
+    std::vector<int> depths;
+    std::vector<uint64_t> correctPerfts;
+    
+    EpdTest(std::istringstream& issline) {
+        /// Parse a single line passed from EPD.
+        /// Each line should consist of the full FEN description of the position
+        /// followed by substrings of the form "D[depth] [perft]", separated by
+        /// semicolons ";".
+        
+        std::string str;
+        // Set FEN string
+        std::getline(issline, strFen, ';');
+        
+        while (std::getline(issline, str, ';')) {
+            int iD = str.find('D');
+            int ispace = str.find(' ');
+            std::string strDepth = str.substr(iD + 1, ispace - iD);
+            std::string strCorrectPerft = str.substr(ispace + 1);
+            depths.push_back(std::stoi(strDepth));
+            correctPerfts.push_back(std::stoull(strCorrectPerft));
+        }
+    }
+};
+
+// Counts the nodes at a depth below a position, however the driver tests.
+// May change pos, but must leave it as it was.
+typedef std::function<uint64_t(int depth, Position& pos)> NodeCounter;
+
+inline double secondsSince(std::chrono::steady_clock::time_point tStart) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - tStart).count();
+}
+
+inline bool runEpdTest(const EpdTest& test, int maxDepth,
+                       const NodeCounter& countNodes) {
+    /// Counts the nodes to all depths up to maxDepth, printing results, and
+    /// stops at the first that differs from the suite.
+    std::cout << "Position: " << test.strFen << "\n";
+    Position pos;
+    if (pos.parseFen(test.strFen) != FEN_OK) {
+        std::cout << "invalid FEN\n";
+        return false;
+    }
+    for (size_t i = 0; i < test.depths.size(); ++i) {
+        if (test.depths[i] > maxDepth) {
+            continue;
+        }
+        const uint64_t res {countNodes(test.depths[i], pos)};
+        const uint64_t check {test.correctPerfts[i]};
+        std::cout << "perft at depth " << std::to_string(test.depths[i])
+                  << ": " << std::to_string(res)
+                  << " (" << std::to_string(check) << ")\n";
+        if (res != check) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void runEpdSuite(const std::string& epdFile, int maxDepth,
+                        const NodeCounter& countNodes, int& numTests,
+                        std::vector<int>& idFails) {
+    /// Runs runEpdTest on each test of the suite in turn, numbering them on
+    /// from numTests.
+    std::ifstream testSuite {epdFile};
+    std::string strTest;
+    while (std::getline(testSuite, strTest)) {
+        const int testId {++numTests};
+        std::istringstream iss {strTest};
+        const EpdTest test {iss};
+        std::cout << "======= Test " << std::to_string(testId) << " =======\n";
+        if (!runEpdTest(test, maxDepth, countNodes)) {
+            idFails.push_back(testId);
+        }
+        std::cout << "\n";
+    }
+    return;
+}
+
+inline void printSummary(int numTests, const std::vector<int>& idFails) {
+    int numFails = idFails.size();
+    float passRate = 100 * static_cast<float>(numTests - numFails) / static_cast<float>(numTests);
+    std::cout << "\n======= Summary =======\n";
+    std::cout << "Passrate = " << std::to_string(passRate) << "%\n";
+    if (idFails.size() > 0) {
+        std::cout << "Failed tests:";
+        for (int idFail: idFails) {
+            std::cout << " " << std::to_string(idFail);
+        }
+    }
+    return;
+}
+
+#endif //#ifndef EPD_SUITE_INCLUDED
\ No newline at end of file
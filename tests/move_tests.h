@@ -113,4 +113,40 @@ class TestSuiteMove: public CxxTest::TestSuite {
     void testGetPromotionType() {
         TS_ASSERT_EQUALS(getPromotionType(e7e8Q), QUEEN);
     }
+};
+
+class TestSuiteMovelist: public CxxTest::TestSuite {
+    public:
+    Move f3g5 = 0x995;
+    Move e7e8Q = 0xDF34;
+    
+    void testNewListIsEmpty() {
+        Movelist mvlist {};
+        TS_ASSERT(mvlist.empty());
+        TS_ASSERT_EQUALS(mvlist.size(), 0);
+    }
+    void testPushBack() {
+        Movelist mvlist {};
+        mvlist.push_back(f3g5);
+        mvlist.push_back(e7e8Q);
+        TS_ASSERT_EQUALS(mvlist.size(), 2);
+        TS_ASSERT_EQUALS(mvlist[0], f3g5);
+        TS_ASSERT_EQUALS(mvlist.back(), e7e8Q);
+    }
+    void testEraseKeepsOrder() {
+        Movelist mvlist {};
+        mvlist.push_back(e7e8Q);
+        mvlist.push_back(f3g5);
+        mvlist.push_back(e7e8Q);
+        mvlist.erase(mvlist.begin());
+        TS_ASSERT_EQUALS(mvlist.size(), 2);
+        TS_ASSERT_EQUALS(mvlist[0], f3g5);
+        TS_ASSERT_EQUALS(mvlist[1], e7e8Q);
+    }
+    void testScore() {
+        ScoredMovelist mvlist {};
+        mvlist.push_back(f3g5);
+        mvlist.setScore(0, -50);
+        TS_ASSERT_EQUALS(mvlist.getScore(0), -50);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "epd_suite.h"
+#include "movegen.h"
+#include "movegen_batch.h"
+#include "perft.h"
+#include "position.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BatchPerft {
+    /// What perftBatch keeps between batches.
+    BatchMovegen gen;
+    std::vector<Position> children;
+    MoveBatch batch;
+    bool isMismatch {false};
+};
+
+uint64_t perftBatch(int depth, Position& pos, BatchPerft& bp) {
+    /// Perft with the moves of the last ply generated by BatchMovegen: the
+    /// children of each node two plies from the leaves form one batch. Each
+    /// child's moves are also checked against generateLegalMoves; if any
+    /// differ, isMismatch is set (and the caller returns 0, so the test fails).
+    if (depth < 2) {return perft(depth, pos);}
+    Movelist mvlist = generateLegalMoves(pos);
+    uint64_t nodes {0};
+    if (depth > 2) {
+        for (Move mv : mvlist) {
+            pos.makeMove(mv);
+            nodes += perftBatch(depth - 1, pos, bp);
+            pos.unmakeMove(mv);
+        }
+        return nodes;
+    }
+    if (bp.children.size() < mvlist.size()) {
+        bp.children.resize(mvlist.size());
+    }
+    for (size_t i = 0; i < mvlist.size(); ++i) {
+        bp.children[i] = pos;
+        bp.children[i].makeMove(mvlist[i]);
+    }
+    bp.gen.generate(bp.children.data(), mvlist.size(), bp.batch);
+    for (size_t i = 0; i < mvlist.size(); ++i) {
+        const Movelist mvlistChild {generateLegalMoves(bp.children[i])};
+        const Move* mvBatch {bp.batch.moves.data() + bp.batch.offsets[i]};
+        if (bp.batch.counts[i] != mvlistChild.size() ||
+            !std::equal(mvlistChild.begin(), mvlistChild.end(), mvBatch)) {
+            bp.isMismatch = true;
+        }
+        nodes += bp.batch.counts[i];
+    }
+    return nodes;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Run the BatchMovegen tests with the command [filename] "
+            "[EPD file path] [Maximum depth] [options] (EPD file path and "
+            "maximum depth required).\n"
+            "Counts perft with the last ply's moves generated by "
+            "BatchMovegen, checking them\n"
+            "against generateLegalMoves.\n"
+            "Options:\n"
+            "  --threads [N]  generate on N threads\n";
+        return 0;
+    }
+    int numThreads {1};
+    for (int iarg = 3; iarg < argc; ++iarg) {
+        std::string strArg {argv[iarg]};
+        if (strArg == "--threads" && iarg + 1 < argc) {
+            numThreads = std::atoi(argv[++iarg]);
+        } else {
+            std::cout << "Unknown option: " << strArg << "\n";
+            return 0;
+        }
+    }
+    std::string epdFile {argv[1]};
+    int maxDepth {std::atoi(argv[2])};
+    int numTests = 0;
+    std::vector<int> idFails;
+    runEpdSuite(epdFile, maxDepth, [numThreads](int depth, Position& pos) {
+        BatchPerft bp {BatchMovegen {numThreads}, {}, {}};
+        const uint64_t nodes {perftBatch(depth, pos, bp)};
+        return bp.isMismatch ? 0 : nodes;
+    }, numTests, idFails);
+    printSummary(numTests, idFails);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "epd_suite.h"
+#include "movegen.h"
+#include "position.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+uint64_t perftModes(int depth, Position& pos) {
+    /// Perft with each node's moves generated as GEN_CAPTURES then GEN_QUIETS,
+    /// or as GEN_EVASIONS when in check, to test the generation modes.
+    if (depth == 0) {return 1;}
+    Movelist mvlist = generateLegalMoves(pos, GEN_EVASIONS);
+    if (mvlist.empty()) {
+        mvlist = generateLegalMoves(pos, GEN_CAPTURES);
+        for (Move mv : generateLegalMoves(pos, GEN_QUIETS)) {
+            mvlist.push_back(mv);
+        }
+    }
+    uint64_t nodes {0};
+    for (Move mv : mvlist) {
+        pos.makeMove(mv);
+        nodes += perftModes(depth - 1, pos);
+        pos.unmakeMove(mv);
+    }
+    return nodes;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cout << "Run the move generation tests with the command "
+            "[filename] [EPD file path] [Maximum depth] (all arguments "
+            "required).\n"
+            "Counts perft with moves generated as captures then quiets, or "
+            "evasions.\n";
+        return 0;
+    }
+    std::string epdFile {argv[1]};
+    int maxDepth {std::atoi(argv[2])};
+    int numTests = 0;
+    std::vector<int> idFails;
+    runEpdSuite(epdFile, maxDepth, perftModes, numTests, idFails);
+    printSummary(numTests, idFails);
+    return 0;
+}
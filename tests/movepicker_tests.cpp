@@ -0,0 +1,55 @@
+#include "epd_suite.h"
+#include "movepicker.h"
+#include "position.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+uint64_t perftPicker(int depth, Position& pos, std::array<Move, 64>& hashMoves) {
+    /// Perft with moves generated by MovePicker, to test it. For the hash move
+    /// it is given the first move of the previous node at the same depth:
+    /// valid in some positions and not in others, so both cases get tested.
+    if (depth == 0) {return 1;}
+    MovePicker mp {pos, hashMoves[depth]};
+    uint64_t nodes {0};
+    bool isFirst {true};
+    for (Move mv = mp.next(); mv != NULL_MOVE; mv = mp.next()) {
+        if (isFirst) {
+            hashMoves[depth] = mv;
+            isFirst = false;
+        }
+        if (depth == 1) {
+            ++nodes;
+            continue;
+        }
+        pos.makeMove(mv);
+        nodes += perftPicker(depth - 1, pos, hashMoves);
+        pos.unmakeMove(mv);
+    }
+    return nodes;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cout << "Run the MovePicker tests with the command [filename] "
+            "[EPD file path] [Maximum depth] (all arguments required).\n"
+            "Counts perft with moves generated by MovePicker, one at a "
+            "time.\n";
+        return 0;
+    }
+    std::string epdFile {argv[1]};
+    int maxDepth {std::atoi(argv[2])};
+    int numTests = 0;
+    std::vector<int> idFails;
+    runEpdSuite(epdFile, maxDepth, [](int depth, Position& pos) {
+        std::array<Move, 64> hashMoves {};
+        return perftPicker(depth, pos, hashMoves);
+    }, numTests, idFails);
+    printSummary(numTests, idFails);
+    return 0;
+}
@@ -1,44 +1,137 @@
 #include "bitboard_lookup.h"
-#include "movegen.h"
+#include "epd_suite.h"
+#include "perft.h"
 #include "position.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
-class SingleTest {
-    /// Class representing a single test (position) from a single line in EPD.
-    public:
+struct RunOptions {
+    /// Options parsed from the command line, after the required arguments.
+    size_t hashMegabytes {0}; // 0 for no transposition table.
+    bool isComparing {false}; // Also run plain perft, to report the speedup.
+    int numThreads {1};
+    bool isScaling {false}; // Report scaling over 1, 2, 4 ... numThreads.
+    bool isBulk {true}; // Count the last ply without making its moves.
+    bool isDividing {false}; // Print node counts below each root move.
+    bool isCountingStats {false}; // Print statistics of the leaves.
+    std::string exportFile; // Write the perfts found here as EPD, if given.
+    int numJobs {0}; // Run this many tests at once, all depths in one pass.
+    bool isAllBackends {false}; // Run once per supported slider backend.
+};
+
+void printDivide(int depth, Position& pos, bool isBulk) {
+    /// Prints the node count below each root move, as perft divide.
+    for (const PerftDivideEntry& entry : perftDivide(depth, pos, isBulk)) {
+        std::cout << "    " << toString(entry.mv) << ": "
+                  << std::to_string(entry.nodes) << "\n";
+    }
+    return;
+}
+
+// Published leaf statistics (from the Chess Programming Wiki's perft results)
+// for the start position and "Kiwipete", which --stats must reproduce.
+struct KnownStats {
     std::string strFen;
-    std::vector<int> depths;
-    std::vector<uint64_t> correctPerfts;
-    
-    SingleTest(std::istringstream& issline) {
-        /// Parse a single line passed from EPD.
-        /// Each line should consist of the full FEN description of the position
-        /// followed by substrings of the form "D[depth] [perft]", separated by
-        /// semicolons ";".
-        
-        std::string str;
-        // Set FEN string
-        std::getline(issline, strFen, ';');
-        
-        while (std::getline(issline, str, ';')) {
-            int iD = str.find('D');
-            int ispace = str.find(' ');
-            std::string strDepth = str.substr(iD + 1, ispace - iD);
-            std::string strCorrectPerft = str.substr(ispace + 1);
-            depths.push_back(std::stoi(strDepth));
-            correctPerfts.push_back(std::stoull(strCorrectPerft));
+    int depth;
+    PerftStats stats; // nodes, captures, ep ... stalemates
+};
+const std::vector<KnownStats> KNOWN_STATS {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 1,
+     {20, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 2,
+     {400, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3,
+     {8902, 34, 0, 0, 0, 12, 0, 0, 0, 0}},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4,
+     {197281, 1576, 0, 0, 0, 469, 0, 0, 8, 0}},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5,
+     {4865609, 82719, 258, 0, 0, 27351, 6, 0, 347, 0}},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6,
+     {119060324, 2812008, 5248, 0, 0, 809099, 329, 46, 10828, 0}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 1,
+     {48, 8, 0, 2, 0, 0, 0, 0, 0, 0}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2,
+     {2039, 351, 1, 91, 0, 3, 0, 0, 0, 0}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3,
+     {97862, 17102, 45, 3162, 0, 993, 0, 0, 1, 0}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4,
+     {4085603, 757163, 1929, 128013, 15172, 25523, 42, 6, 43, 0}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5,
+     {193690690, 35043416, 73365, 4993637, 8392, 3309887, 19883, 2645,
+      30171, 0}}
+};
+
+bool isSameStats(const PerftStats& lhs, const PerftStats& rhs) {
+    return lhs.nodes == rhs.nodes && lhs.captures == rhs.captures &&
+           lhs.eps == rhs.eps && lhs.castles == rhs.castles &&
+           lhs.promotions == rhs.promotions && lhs.checks == rhs.checks &&
+           lhs.discoveredChecks == rhs.discoveredChecks &&
+           lhs.doubleChecks == rhs.doubleChecks &&
+           lhs.checkmates == rhs.checkmates &&
+           lhs.stalemates == rhs.stalemates;
+}
+
+bool printStats(int depth, Position& pos) {
+    /// Prints the statistics of the leaves of perft. Returns false if they
+    /// differ from the published ones, for a position and depth in
+    /// KNOWN_STATS.
+    PerftStats stats;
+    perftStats(depth, pos, stats);
+    std::cout << "    captures " << std::to_string(stats.captures)
+              << ", ep " << std::to_string(stats.eps)
+              << ", castles " << std::to_string(stats.castles)
+              << ", promotions " << std::to_string(stats.promotions)
+              << ", checks " << std::to_string(stats.checks)
+              << ", discovered checks " << std::to_string(stats.discoveredChecks)
+              << ", double checks " << std::to_string(stats.doubleChecks)
+              << ", checkmates " << std::to_string(stats.checkmates)
+              << ", stalemates " << std::to_string(stats.stalemates) << "\n";
+    const std::string strFen {pos.toFen()};
+    for (const KnownStats& known : KNOWN_STATS) {
+        if (known.depth == depth && known.strFen == strFen &&
+            !isSameStats(known.stats, stats)) {
+            std::cout << "    statistics differ from the published ones\n";
+            return false;
         }
     }
+    return true;
+}
+
+uint64_t runPerft(int depth, const Position& pos, const RunOptions& opts,
+                  PerftTable* table) {
+    /// Runs single-threaded or parallel perft, with or without a table.
+    if (opts.numThreads > 1) {
+        return perftParallel(depth, pos, opts.numThreads, table, opts.isBulk);
+    }
+    Position posCopy {pos};
+    return table ? perft(depth, posCopy, *table, opts.isBulk)
+                 : perft(depth, posCopy, opts.isBulk);
+}
+
+
+class SingleTest : public EpdTest {
+    /// A test from the suite, keeping the perfts found to export them.
+    public:
+    std::vector<PerftEpdEntry> foundPerfts; // filled in by run()
     
-    bool run(int maxDepth) {
+    SingleTest(std::istringstream& issline) : EpdTest {issline} {}
+    
+    bool run(int maxDepth, const RunOptions& opts, PerftTable* table) {
         /// Runs perft to all depths smaller than maxDepth, printing results.
+        /// If a table is given, perft uses it, and the hit rate is printed.
         
         // TODO: can separate printing from logic.
         bool isTestCorrect = true;
@@ -50,28 +143,313 @@ class SingleTest {
                 continue;
             }
             pos.fromFen(strFen);
-            uint64_t res = perft(depths[i], pos);
+            uint64_t res {0};
+            std::string strHashInfo;
+            if (table) {
+                const uint64_t probesBefore {table->getNumProbes()};
+                const uint64_t hitsBefore {table->getNumHits()};
+                auto tStart = std::chrono::steady_clock::now();
+                res = runPerft(depths[i], pos, opts, table);
+                const double secsHashed {secondsSince(tStart)};
+                const uint64_t probes {table->getNumProbes() - probesBefore};
+                const uint64_t hits {table->getNumHits() - hitsBefore};
+                strHashInfo = " [hash hits " + std::to_string(hits) + "/" +
+                              std::to_string(probes);
+                if (probes > 0) {
+                    strHashInfo += " (" +
+                        std::to_string(100.0 * hits / probes) + "%)";
+                }
+                if (opts.isComparing) {
+                    // Plain recursion must agree exactly, as well as be slower.
+                    pos.fromFen(strFen);
+                    tStart = std::chrono::steady_clock::now();
+                    uint64_t resPlain = runPerft(depths[i], pos,
+                                                 opts, nullptr);
+                    const double secsPlain {secondsSince(tStart)};
+                    strHashInfo += ", speedup " +
+                                   std::to_string(secsPlain / secsHashed);
+                    if (resPlain != res) {
+                        strHashInfo += ", plain perft " +
+                                       std::to_string(resPlain) + " DIFFERS";
+                        isTestCorrect = false;
+                    }
+                }
+                strHashInfo += "]";
+            } else {
+                res = runPerft(depths[i], pos, opts, nullptr);
+            }
+            foundPerfts.push_back({depths[i], res});
             uint64_t check = correctPerfts[i];
             std::cout << "perft at depth " << std::to_string(depths[i]) << ": "
                       << std::to_string(res)
-                      << " (" << std::to_string(check) << ")" << "\n";
+                      << " (" << std::to_string(check) << ")"
+                      << strHashInfo << "\n";
+            if (opts.isDividing) {
+                printDivide(depths[i], pos, opts.isBulk);
+            }
+            if (opts.isCountingStats && !printStats(depths[i], pos)) {
+                isTestCorrect = false;
+            }
             
-            if (res != check) {
+            if (res != check || !isTestCorrect) {
                 isTestCorrect = false;
                 break;
             }
         }
+        if (opts.isScaling && isTestCorrect) {
+            reportScaling(maxDepth, opts);
+        }
         return isTestCorrect;
     }
+    
+    int getDeepest(int maxDepth) const {
+        /// The deepest depth to run, not above maxDepth (0 if none).
+        int depth {0};
+        for (int d : depths) {
+            if (d <= maxDepth && d > depth) {depth = d;}
+        }
+        return depth;
+    }
+    
+    bool check(int maxDepth, const std::vector<uint64_t>& nodesByDepth) {
+        /// Checks node counts found for every depth at once (indexed by
+        /// depth, as from perftAllDepths), keeping them in foundPerfts.
+        bool isTestCorrect = true;
+        int size = depths.size();
+        for (int i = 0; i < size; ++i) {
+            if (depths[i] > maxDepth) {
+                continue;
+            }
+            uint64_t res = nodesByDepth[depths[i]];
+            foundPerfts.push_back({depths[i], res});
+            if (res != correctPerfts[i]) {
+                isTestCorrect = false;
+            }
+        }
+        return isTestCorrect;
+    }
+    
+    void reportScaling(int maxDepth, const RunOptions& opts) {
+        /// Times parallel perft at the deepest depth run, for thread counts
+        /// 1, 2, 4 ... up to numThreads (always included).
+        const int depth {getDeepest(maxDepth)};
+        Position pos;
+        pos.fromFen(strFen);
+        double secsOneThread {0};
+        for (int n = 1; n <= opts.numThreads; n *= 2) {
+            // Jump to numThreads itself if it is not a power of two.
+            if (n * 2 > opts.numThreads && n != opts.numThreads) {
+                n = opts.numThreads;
+            }
+            auto tStart = std::chrono::steady_clock::now();
+            uint64_t nodes = perftParallel(depth, pos, n, nullptr,
+                                           opts.isBulk);
+            const double secs {secondsSince(tStart)};
+            if (n == 1) {secsOneThread = secs;}
+            std::cout << "scaling at depth " << std::to_string(depth)
+                      << ", " << std::to_string(n) << " threads: "
+                      << std::to_string(secs) << " s, "
+                      << std::to_string(static_cast<uint64_t>(nodes / secs))
+                      << " nps, speedup "
+                      << std::to_string(secsOneThread / secs) << "\n";
+        }
+        return;
+    }
 };
 
 
+bool checkSliderLookups() {
+    /// Checks the slider backend in use against KINDERGARTEN on every
+    /// relevant occupancy of every square, so that a magic number sending
+    /// two occupancies with different attacks to one entry is found.
+    for (int isq = 0; isq < NUM_SQUARES; ++isq) {
+        const Square sq {square(isq)};
+        for (bool isRook : {false, true}) {
+            const Bitboard bbMask {isRook ? rookMagics[sq].mask
+                                          : bishopMagics[sq].mask};
+            Bitboard bbOcc {BB_NONE};
+            do {
+                if (isRook ? rookAttacks(sq, bbOcc) !=
+                             rookAttacksKindergarten(sq, bbOcc)
+                           : bishopAttacks(sq, bbOcc) !=
+                             bishopAttacksKindergarten(sq, bbOcc)) {
+                    return false;
+                }
+                bbOcc = (bbOcc - bbMask) & bbMask;
+            } while (bbOcc);
+        }
+    }
+    return true;
+}
+
+
+void exportTest(std::ofstream& exportSuite, const SingleTest& test) {
+    /// Writes the perfts found by a test as a line of a new suite.
+    Position pos;
+    char buf[1024];
+    if (pos.parseFen(test.strFen) == FEN_OK &&
+        toPerftEpd(buf, sizeof(buf), pos, test.foundPerfts.data(),
+                   test.foundPerfts.size())) {
+        exportSuite << buf << "\n";
+    }
+    return;
+}
+
+
+// === Parallel runner ===
+struct JobResult {
+    /// What a worker found for one test: node counts indexed by depth.
+    std::vector<uint64_t> nodesByDepth;
+    double secs {0};
+    bool isFenOk {true};
+    bool isDone {false};
+};
+
+void runTestsParallel(std::vector<SingleTest>& tests, int maxDepth,
+                      int numJobs, bool isBulk, std::vector<int>& idFails) {
+    /// Runs the tests on a pool of numJobs threads. Each thread takes the next
+    /// test nobody has taken, and counts all its depths in one perft (so the
+    /// shallower depths are not run again). Results are printed in input
+    /// order, each as soon as it and those before it are done.
+    std::vector<JobResult> results(tests.size());
+    std::atomic<size_t> iNext {0};
+    std::mutex mtx;
+    std::condition_variable cvDone;
+    auto worker = [&]() {
+        Position pos;
+        for (size_t i = iNext++; i < tests.size(); i = iNext++) {
+            const int depth {tests[i].getDeepest(maxDepth)};
+            std::vector<uint64_t> nodesByDepth(depth + 1, 0);
+            const auto tStart = std::chrono::steady_clock::now();
+            const bool isFenOk {pos.parseFen(tests[i].strFen) == FEN_OK};
+            if (isFenOk) {
+                perftAllDepths(depth, pos, nodesByDepth.data(), isBulk);
+            }
+            const double secs {secondsSince(tStart)};
+            {
+                std::lock_guard<std::mutex> lock {mtx};
+                results[i].nodesByDepth.swap(nodesByDepth);
+                results[i].secs = secs;
+                results[i].isFenOk = isFenOk;
+                results[i].isDone = true;
+            }
+            cvDone.notify_one();
+        }
+    };
+    
+    const auto tStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numJobs; ++i) {
+        threads.emplace_back(worker);
+    }
+    std::cout << std::setw(6) << "Test" << std::setw(7) << "Depth"
+              << std::setw(14) << "Nodes" << std::setw(11) << "Time (s)"
+              << std::setw(14) << "NPS" << "  Result  Position\n";
+    uint64_t totalNodes {0};
+    for (size_t i = 0; i < tests.size(); ++i) {
+        std::unique_lock<std::mutex> lock {mtx};
+        cvDone.wait(lock, [&]() {return results[i].isDone;});
+        lock.unlock();
+        const JobResult& result {results[i]};
+        SingleTest& test {tests[i]};
+        const int depth {test.getDeepest(maxDepth)};
+        const uint64_t nodes {result.isFenOk ? result.nodesByDepth[depth] : 0};
+        totalNodes += nodes;
+        const bool isTestCorrect {
+            result.isFenOk && test.check(maxDepth, result.nodesByDepth)
+        };
+        const int testId {static_cast<int>(i) + 1};
+        std::cout << std::setw(6) << testId << std::setw(7) << depth
+                  << std::setw(14) << nodes << std::setw(11) << std::fixed
+                  << std::setprecision(3) << result.secs << std::setw(14)
+                  << static_cast<uint64_t>(nodes / result.secs) << "  "
+                  << std::left << std::setw(6)
+                  << (!result.isFenOk ? "BADFEN" : isTestCorrect ? "ok" : "FAIL")
+                  << std::right << "  " << test.strFen << "\n";
+        std::cout.unsetf(std::ios::fixed);
+        if (!isTestCorrect) {
+            idFails.push_back(testId);
+            for (size_t j = 0; j < test.depths.size(); ++j) {
+                const int d {test.depths[j]};
+                if (d > maxDepth || !result.isFenOk) {
+                    continue;
+                }
+                std::cout << "    perft at depth " << std::to_string(d) << ": "
+                          << std::to_string(result.nodesByDepth[d]) << " ("
+                          << std::to_string(test.correctPerfts[j]) << ")\n";
+            }
+        }
+    }
+    for (std::thread& th : threads) {
+        th.join();
+    }
+    const double secs {secondsSince(tStart)};
+    std::cout << "\nTotal: " << std::to_string(totalNodes) << " nodes in "
+              << std::to_string(secs) << " s ("
+              << std::to_string(static_cast<uint64_t>(totalNodes / secs))
+              << " nps) on " << std::to_string(numJobs) << " threads\n";
+    return;
+}
+
+
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
+    if (argc < 3) {
         std::cout << "Run the perft tests with the command [filename] "
-            "[EPD file path] [Maximum depth] (all arguments required).\n";
+            "[EPD file path] [Maximum depth] [options] (EPD file path and "
+            "maximum depth required).\n"
+            "Options:\n"
+            "  --hash [MB]  use a perft transposition table of this size\n"
+            "  --compare    with --hash, also run plain perft and report the "
+            "speedup\n"
+            "  --threads [N]  run perft on N threads\n"
+            "  --scaling    report parallel speedup for 1, 2, 4 ... N threads\n"
+            "  --no-bulk    make and unmake every move at the last ply, instead "
+            "of counting them\n"
+            "  --divide     also print the node count below each root move\n"
+            "  --stats      also print captures, checks, mates etc. at the "
+            "leaves, checking\n"
+            "               them where published (start position, "
+            "Kiwipete)\n"
+            "  --export [EPD file path]  write the perfts found to a new "
+            "suite\n"
+            "  --jobs [N]   run the tests on a pool of N threads, each test's "
+            "depths in one\n"
+            "               pass, printing a table (only --no-bulk and "
+            "--export also apply)\n"
+            "  --backends   run the tests once per supported slider backend, "
+            "each after\n"
+            "               checking its lookups on every occupancy (not with "
+            "--jobs)\n";
         return 0;
     }
+    RunOptions opts;
+    for (int iarg = 3; iarg < argc; ++iarg) {
+        std::string strArg {argv[iarg]};
+        if (strArg == "--hash" && iarg + 1 < argc) {
+            opts.hashMegabytes = std::strtoull(argv[++iarg], nullptr, 10);
+        } else if (strArg == "--compare") {
+            opts.isComparing = true;
+        } else if (strArg == "--threads" && iarg + 1 < argc) {
+            opts.numThreads = std::atoi(argv[++iarg]);
+        } else if (strArg == "--scaling") {
+            opts.isScaling = true;
+        } else if (strArg == "--jobs" && iarg + 1 < argc) {
+            opts.numJobs = std::atoi(argv[++iarg]);
+        } else if (strArg == "--export" && iarg + 1 < argc) {
+            opts.exportFile = argv[++iarg];
+        } else if (strArg == "--divide") {
+            opts.isDividing = true;
+        } else if (strArg == "--stats") {
+            opts.isCountingStats = true;
+        } else if (strArg == "--no-bulk") {
+            opts.isBulk = false;
+        } else if (strArg == "--backends") {
+            opts.isAllBackends = true;
+        } else {
+            std::cout << "Unknown option: " << strArg << "\n";
+            return 0;
+        }
+    }
     
     // Open EPD file.
     std::string epdFile {argv[1]};
@@ -84,35 +462,88 @@ int main(int argc, char* argv[]) {
     int testId = 0;
     int numTests = 0;
     std::vector<int> idFails;
+    std::unique_ptr<PerftTable> table;
+    if (opts.hashMegabytes > 0) {
+        table = std::make_unique<PerftTable>(opts.hashMegabytes);
+        std::cout << "Using perft hash table with "
+                  << std::to_string(table->getNumEntries()) << " entries.\n";
+    }
     
-    initialiseBbLookup();
+    std::ofstream exportSuite;
+    if (!opts.exportFile.empty()) {
+        exportSuite.open(opts.exportFile);
+    }
     
-    // Run each test in the testSuite (parsed from EPD).
-    while (std::getline(testSuite, strTest)) {
-        ++numTests;
-        ++testId;
-        bool isTestCorrect = true;
-        std::istringstream iss {strTest};
-        SingleTest test {iss};
-        std::cout << "======= Test " << std::to_string(testId) << " =======\n";
-        isTestCorrect = test.run(maxDepth);
-        if (!isTestCorrect) {
-            idFails.push_back(testId);
+    // Run all the tests at once on the pool, if asked to.
+    if (opts.numJobs > 0) {
+        std::vector<SingleTest> tests;
+        while (std::getline(testSuite, strTest)) {
+            ++numTests;
+            std::istringstream iss {strTest};
+            tests.emplace_back(iss);
+        }
+        runTestsParallel(tests, maxDepth, opts.numJobs, opts.isBulk, idFails);
+        if (exportSuite.is_open()) {
+            for (const SingleTest& test : tests) {
+                exportTest(exportSuite, test);
+            }
         }
-        std::cout << "\n";
     }
-    testSuite.close();
     
-    // Print testing summary
-    int numFails = idFails.size();
-    float passRate = 100 * static_cast<float>(numTests - numFails) / static_cast<float>(numTests);
-    std::cout << "\n======= Summary =======\n";
-    std::cout << "Passrate = " << std::to_string(passRate) << "%\n";
-    if (idFails.size() > 0) {
-        std::cout << "Failed tests:";
-        for (int idFail: idFails) {
-            std::cout << " " << std::to_string(idFail);
+    // Otherwise run each test in the testSuite (parsed from EPD) in turn,
+    // once per slider backend if asked to.
+    std::vector<SliderBackend> backends {getSliderBackend()};
+    if (opts.isAllBackends) {
+        backends = {KINDERGARTEN, MAGIC, PEXT};
+    }
+    const SliderBackend sbDetected {getSliderBackend()};
+    bool isFirstPass {true};
+    for (SliderBackend sb : backends) {
+        if (opts.numJobs > 0) {
+            break;
+        }
+        // A backend fixed at build time can't be changed.
+        if (!setSliderBackend(sb) || getSliderBackend() != sb) {
+            continue;
         }
+        if (opts.isAllBackends) {
+            ++numTests;
+            ++testId;
+            std::cout << "======= Slider backend " << std::to_string(sb)
+                      << " (test " << std::to_string(testId) << ") =======\n";
+            if (!checkSliderLookups()) {
+                std::cout << "lookups differ from KINDERGARTEN\n";
+                idFails.push_back(testId);
+            }
+            std::cout << "\n";
+            // Later backends must not just read the earlier ones' perfts.
+            if (table) {table->clear();}
+            testSuite.clear();
+            testSuite.seekg(0);
+        }
+        while (std::getline(testSuite, strTest)) {
+            ++numTests;
+            ++testId;
+            bool isTestCorrect = true;
+            std::istringstream iss {strTest};
+            SingleTest test {iss};
+            std::cout << "======= Test " << std::to_string(testId)
+                      << " =======\n";
+            isTestCorrect = test.run(maxDepth, opts, table.get());
+            if (!isTestCorrect) {
+                idFails.push_back(testId);
+            }
+            if (exportSuite.is_open() && isFirstPass) {
+                exportTest(exportSuite, test);
+            }
+            std::cout << "\n";
+        }
+        isFirstPass = false;
     }
+    setSliderBackend(sbDetected);
+    testSuite.close();
+    
+    // Print testing summary
+    printSummary(numTests, idFails);
     return 0;
 }
@@ -0,0 +1,320 @@
+#include "epd_suite.h"
+#include "perft.h"
+#include "position.h"
+#include "position_db.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Suites converted by --make-db hold, after each packed position, the correct
+// perfts at depths 1 to MAX_DB_DEPTH (NO_PERFT where not given).
+constexpr int MAX_DB_DEPTH {8};
+constexpr uint64_t NO_PERFT {UINT64_MAX};
+typedef std::array<uint64_t, MAX_DB_DEPTH> DbPerfts;
+
+bool makeDb(const std::string& epdFile, const std::string& dbFile) {
+    /// Converts an EPD suite to a position database, with an index.
+    std::ifstream testSuite {epdFile};
+    PositionDbWriter writer;
+    if (!testSuite || !writer.open(dbFile, sizeof(DbPerfts))) {
+        return false;
+    }
+    std::string strTest;
+    Position pos;
+    while (std::getline(testSuite, strTest)) {
+        std::istringstream iss {strTest};
+        const EpdTest test {iss};
+        DbPerfts perfts;
+        perfts.fill(NO_PERFT);
+        for (size_t i = 0; i < test.depths.size(); ++i) {
+            if (1 <= test.depths[i] && test.depths[i] <= MAX_DB_DEPTH) {
+                perfts[test.depths[i] - 1] = test.correctPerfts[i];
+            }
+        }
+        if (pos.parseFen(test.strFen) != FEN_OK ||
+            !writer.add(pos, perfts.data())) {
+            return false;
+        }
+    }
+    return writer.finish(true);
+}
+
+struct DbFailure {
+    /// A record that failed, how, and the perfts found (by depth).
+    enum Kind {WRONG_PERFT, MALFORMED, NOT_INDEXED};
+    size_t irec {0};
+    Kind kind {WRONG_PERFT};
+    std::vector<uint64_t> nodesByDepth;
+};
+
+void runDbWorker(const PositionDb& db, size_t first, size_t last,
+                 int maxDepth, bool isBulk, std::vector<DbFailure>& failures,
+                 uint64_t& nodes) {
+    /// Runs the records [first, last), decoding each straight from the
+    /// mapping into one Position and counting all its depths in one pass.
+    /// If the database has an index, each position must be found in it
+    /// (as this record, or an earlier one of the same position).
+    Position pos;
+    std::vector<uint64_t> nodesByDepth;
+    nodes = 0;
+    for (size_t irec = first; irec < last; ++irec) {
+        DbPerfts perfts;
+        std::memcpy(perfts.data(), db.getPayload(irec), sizeof(perfts));
+        int depth {0};
+        for (int d = 1; d <= std::min(maxDepth, MAX_DB_DEPTH); ++d) {
+            if (perfts[d - 1] != NO_PERFT) {depth = d;}
+        }
+        if (!db.decode(irec, pos)) {
+            failures.push_back({irec, DbFailure::MALFORMED, {}});
+            continue;
+        }
+        if (db.hasIndex() && db.find(pos.getKey()) > irec) {
+            failures.push_back({irec, DbFailure::NOT_INDEXED, {}});
+            continue;
+        }
+        nodesByDepth.assign(depth + 1, 0);
+        perftAllDepths(depth, pos, nodesByDepth.data(), isBulk);
+        nodes += nodesByDepth[depth];
+        for (int d = 1; d <= depth; ++d) {
+            if (perfts[d - 1] != NO_PERFT && perfts[d - 1] != nodesByDepth[d]) {
+                failures.push_back({irec, DbFailure::WRONG_PERFT,
+                                    nodesByDepth});
+                break;
+            }
+        }
+    }
+    return;
+}
+
+void runDbParallel(const PositionDb& db, size_t first, size_t last,
+                   int maxDepth, int numJobs, bool isBulk,
+                   std::vector<int>& idFails) {
+    /// Runs the records [first, last) of a database, split into equal ranges
+    /// over numJobs threads sharing the one mapping. Only failures are
+    /// printed (in input order), then the totals.
+    std::vector<std::vector<DbFailure>> failuresByThread(numJobs);
+    std::vector<uint64_t> nodesByThread(numJobs, 0);
+    std::vector<std::thread> threads;
+    const auto tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < numJobs; ++i) {
+        const size_t n {last - first};
+        threads.emplace_back(runDbWorker, std::cref(db),
+                             first + n * i / numJobs,
+                             first + n * (i + 1) / numJobs, maxDepth, isBulk,
+                             std::ref(failuresByThread[i]),
+                             std::ref(nodesByThread[i]));
+    }
+    uint64_t totalNodes {0};
+    for (int i = 0; i < numJobs; ++i) {
+        threads[i].join();
+        totalNodes += nodesByThread[i];
+    }
+    const double secs {secondsSince(tStart)};
+    Position pos;
+    char buf[MAX_FEN_LENGTH];
+    for (const std::vector<DbFailure>& failures : failuresByThread) {
+        for (const DbFailure& failure : failures) {
+            const int testId {static_cast<int>(failure.irec) + 1};
+            idFails.push_back(testId);
+            std::cout << "Test " << std::to_string(testId) << ": ";
+            if (failure.kind == DbFailure::MALFORMED) {
+                std::cout << "malformed record\n";
+                continue;
+            }
+            db.decode(failure.irec, pos);
+            pos.toFen(buf, sizeof(buf));
+            std::cout << buf << "\n";
+            if (failure.kind == DbFailure::NOT_INDEXED) {
+                std::cout << "    not found in the index\n";
+                continue;
+            }
+            DbPerfts perfts;
+            std::memcpy(perfts.data(), db.getPayload(failure.irec),
+                        sizeof(perfts));
+            for (size_t d = 1; d < failure.nodesByDepth.size(); ++d) {
+                if (perfts[d - 1] == NO_PERFT) {
+                    continue;
+                }
+                std::cout << "    perft at depth " << std::to_string(d) << ": "
+                          << std::to_string(failure.nodesByDepth[d]) << " ("
+                          << std::to_string(perfts[d - 1]) << ")\n";
+            }
+        }
+    }
+    std::cout << "Total: " << std::to_string(last - first) << " positions, "
+              << std::to_string(totalNodes) << " nodes in "
+              << std::to_string(secs) << " s ("
+              << std::to_string(static_cast<uint64_t>(totalNodes / secs))
+              << " nps) on " << std::to_string(numJobs) << " threads\n";
+    return;
+}
+
+
+bool isOpened(const std::string& path, const std::vector<char>& bytes,
+              const PositionDbHeader& hdr) {
+    /// Writes the file bytes, with hdr for its header, to path, and tries to
+    /// open it as a database.
+    std::vector<char> bytesOut {bytes};
+    std::memcpy(bytesOut.data(), &hdr, sizeof(hdr));
+    {
+        std::ofstream file {path, std::ios::binary};
+        file.write(bytesOut.data(), bytesOut.size());
+    }
+    PositionDb db;
+    const bool isOpen {db.open(path)};
+    db.close();
+    std::remove(path.c_str());
+    return isOpen;
+}
+
+void runBadHeaderTests(const std::string& dbFile, int firstId,
+                       int& numTests, std::vector<int>& idFails) {
+    /// Copies the database with its header damaged to say more than the file
+    /// holds, mostly in sizes that wrap around, if added or multiplied
+    /// unchecked, to seem to fit; open() must reject each copy (and accept
+    /// an undamaged one).
+    std::ifstream file {dbFile, std::ios::binary};
+    const std::vector<char> bytes {std::istreambuf_iterator<char> {file},
+                                   std::istreambuf_iterator<char> {}};
+    PositionDbHeader hdr;
+    if (bytes.size() < sizeof(hdr)) {return;}
+    std::memcpy(&hdr, bytes.data(), sizeof(hdr));
+    const uint64_t recSize {sizeof(PackedPosition) + hdr.payloadSize};
+    std::vector<PositionDbHeader> badHeaders(4, hdr);
+    // The index 8 bytes short of the end of the address space, so that it
+    // ends at 8.
+    badHeaders[0].indexOffset = UINT64_MAX - 7;
+    badHeaders[0].numIndexSlots = 1;
+    // Enough index slots to wrap.
+    badHeaders[1].indexOffset = bytes.size() / 8 * 8;
+    badHeaders[1].numIndexSlots = uint64_t {1} << 60;
+    // Enough records to wrap.
+    badHeaders[2].numRecords = UINT64_MAX / recSize + 1;
+    // A payload as big as the file, with a record more than fits.
+    badHeaders[3].payloadSize = bytes.size() / 8 * 8;
+    badHeaders[3].numRecords = 1;
+    const std::string path {dbFile + ".bad"};
+    int testId {firstId};
+    ++numTests;
+    if (!isOpened(path, bytes, hdr)) {
+        idFails.push_back(testId);
+    }
+    for (const PositionDbHeader& hdrBad : badHeaders) {
+        ++numTests;
+        ++testId;
+        if (isOpened(path, bytes, hdrBad)) {
+            std::cout << "Test " << std::to_string(testId)
+                      << ": damaged header accepted\n";
+            idFails.push_back(testId);
+        }
+    }
+    return;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Run the position database tests with the command "
+            "[filename] [EPD or database file path] [Maximum depth] [options] "
+            "(file path and\n"
+            "maximum depth required).\n"
+            "An EPD suite is converted to a temporary database first. Each "
+            "record is decoded\n"
+            "from the mapping, found in the index and counted to all its "
+            "depths in one pass.\n"
+            "Options:\n"
+            "  --make-db [file path]  convert the EPD suite to a position "
+            "database, and exit\n"
+            "  --part [K] [N]  run only the Kth of N parts (from 0), e.g. one "
+            "per process\n"
+            "  --jobs [N]   run on N threads\n"
+            "  --no-bulk    make and unmake every move at the last ply, instead "
+            "of counting them\n";
+        return 0;
+    }
+    std::string dbFile; // to convert the suite to, and exit
+    int iPart {0};
+    int numParts {1};
+    int numJobs {1};
+    bool isBulk {true};
+    for (int iarg = 3; iarg < argc; ++iarg) {
+        std::string strArg {argv[iarg]};
+        if (strArg == "--make-db" && iarg + 1 < argc) {
+            dbFile = argv[++iarg];
+        } else if (strArg == "--part" && iarg + 2 < argc) {
+            iPart = std::atoi(argv[++iarg]);
+            numParts = std::atoi(argv[++iarg]);
+            if (numParts < 1 || iPart < 0 || iPart >= numParts) {
+                std::cout << "Invalid part.\n";
+                return 1;
+            }
+        } else if (strArg == "--jobs" && iarg + 1 < argc) {
+            numJobs = std::max(std::atoi(argv[++iarg]), 1);
+        } else if (strArg == "--no-bulk") {
+            isBulk = false;
+        } else {
+            std::cout << "Unknown option: " << strArg << "\n";
+            return 0;
+        }
+    }
+    
+    // Convert the EPD file, if asked to.
+    std::string epdFile {argv[1]};
+    if (!dbFile.empty()) {
+        const bool isMade {makeDb(epdFile, dbFile)};
+        std::cout << (isMade ? "Wrote " : "Could not write ") << dbFile
+                  << "\n";
+        return isMade ? 0 : 1;
+    }
+    // Open the database, or convert the EPD file to one in its place.
+    PositionDb db;
+    std::string tmpFile;
+    if (!db.open(epdFile)) {
+        std::ifstream testSuite {epdFile};
+        // A damaged database would otherwise be read as (garbage) EPD.
+        char magic[sizeof(PositionDbHeader::magic)] {};
+        testSuite.read(magic, sizeof(magic));
+        if (std::memcmp(magic, PositionDbHeader {}.magic, sizeof(magic)) == 0) {
+            std::cout << "Invalid position database: " << epdFile << "\n";
+            return 0;
+        }
+        tmpFile = epdFile + ".tmpdb";
+        if (!makeDb(epdFile, tmpFile) || !db.open(tmpFile)) {
+            std::cout << "Could not convert " << epdFile << "\n";
+            std::remove(tmpFile.c_str());
+            return 1;
+        }
+    }
+    
+    // Run the records (or a part of them) on the pool.
+    int maxDepth {std::atoi(argv[2])};
+    std::vector<int> idFails;
+    const std::pair<size_t, size_t> part {db.getPartition(iPart, numParts)};
+    int numTests = part.second - part.first;
+    runDbParallel(db, part.first, part.second, maxDepth, numJobs, isBulk,
+                  idFails);
+    const int firstBadId {static_cast<int>(db.size()) + 1};
+    db.close();
+    // The damaged headers follow on from the records.
+    runBadHeaderTests(tmpFile.empty() ? epdFile : tmpFile, firstBadId,
+                      numTests, idFails);
+    if (!tmpFile.empty()) {
+        std::remove(tmpFile.c_str());
+    }
+    
+    printSummary(numTests, idFails);
+    return 0;
+}
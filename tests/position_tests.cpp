@@ -4,6 +4,7 @@
 #include "position.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -13,6 +14,52 @@
 // test format:
 // [position];[fromSq,toSq,special,promopiece];[final position]
 
+// Malformed FENs, and the error parseFen should give for each.
+struct BadFenTest {
+    std::string strFen;
+    FenError err;
+};
+const std::vector<BadFenTest> BAD_FEN_TESTS {
+    {"", FEN_BAD_BOARD},
+    {"4k3/8/8/8/8/8/8 w - - 0 1", FEN_BAD_BOARD},
+    {"4k3/8/8/8/8/8/8/4K3/8 w - - 0 1", FEN_BAD_BOARD},
+    {"4k4/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_BOARD},
+    {"4k3/8/8/8/8/8/8/4K2 w - - 0 1", FEN_BAD_BOARD},
+    {"4x3/8/8/8/8/8/8/4K3 w - - 0 1", FEN_BAD_BOARD},
+    {"4k3/8/8/8/8/8/8/4K3", FEN_BAD_SIDE},
+    {"4k3/8/8/8/8/8/8/4K3 white - - 0 1", FEN_BAD_SIDE},
+    {"4k3/8/8/8/8/8/8/4K3 w", FEN_BAD_CASTLING},
+    {"4k3/8/8/8/8/8/8/4K3 w KX - 0 1", FEN_BAD_CASTLING},
+    {"4k3/8/8/8/8/8/8/4K3 w - e4 0 1", FEN_BAD_EP},
+    {"4k3/8/8/8/8/8/8/4K3 w - - x 1", FEN_BAD_COUNTER},
+    {"4k3/8/8/8/8/8/8/4K3 w - - 0 -1", FEN_BAD_COUNTER},
+    {"4k3/8/8/8/8/8/8/4K3 w - - 0 1 bm", FEN_EXTRA_FIELDS}
+};
+
+bool isSameCheckInfo(const CheckInfo& lhs, const CheckInfo& rhs) {
+    return lhs.bbCheckers == rhs.bbCheckers &&
+           lhs.bbBlockers == rhs.bbBlockers &&
+           lhs.bbCheckSquares == rhs.bbCheckSquares;
+}
+
+bool isSameBoard(const PackedPosition& packed, const Position& pos) {
+    PackedBoard board;
+    if (!unpackBoard(packed, board) || board.key != pos.getKey() ||
+        board.sideToMove != pos.getSideToMove() ||
+        board.castlingRights != pos.getCastlingRights() ||
+        board.epSq != pos.getEpSq()) {
+        return false;
+    }
+    for (int ipc = 0; ipc < NUM_PIECES; ++ipc) {
+        const Piece pc {static_cast<Piece>(ipc)};
+        if (board.bbByPiece[ipc] !=
+            pos.getUnitsBb(getPieceColour(pc), getPieceType(pc))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 class SingleMoveTest {
     public:
     Position posTest;
@@ -75,16 +122,87 @@ class SingleMoveTest {
     }
     
     bool runUnmake() {
+        /// Also checks the CheckInfo cached before the move is restored on
+        /// unmaking it, and that the one after the move is not left stale.
         bool isPassed = true;
         posTest.fromFen(strFenBefore);
+        const CheckInfo ciBefore {posTest.getCheckInfo()};
         posTest.makeMove(mv);
+        if (!isSameCheckInfo(posTest.getCheckInfo(), posAfter.getCheckInfo())) {
+            isPassed = false;
+        }
         posTest.unmakeMove(mv);
-        if (posTest != posBefore) {
+        if (posTest != posBefore ||
+            !isSameCheckInfo(posTest.getCheckInfo(), ciBefore) ||
+            !isSameCheckInfo(ciBefore, posBefore.getCheckInfo())) {
             isPassed = false;
         }
         return isPassed;
     }
     
+    bool runFen() {
+        /// Writes the positions before and after back out as FEN, which
+        /// should give the suite's FENs.
+        /// Then parses the FEN again, reformatted within what parseFen
+        /// tolerates: runs of mixed whitespace between fields, and no move
+        /// counters.
+        if (posBefore.toFen() != strFenBefore ||
+            posAfter.toFen() != strFenAfter) {
+            return false;
+        }
+        std::string strSpaced {" "};
+        for (char c : strFenBefore) {
+            strSpaced += (c == ' ') ? std::string {" \t "} : std::string {c};
+        }
+        strSpaced += "\n";
+        size_t iCounters {0};
+        for (int i = 0; i < 4; ++i) {
+            iCounters = strFenBefore.find(' ', iCounters + 1);
+        }
+        const std::string strNoCounters {strFenBefore.substr(0, iCounters)};
+        for (const std::string& str : {strSpaced, strNoCounters}) {
+            if (posTest.parseFen(str) != FEN_OK || posTest != posBefore) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool runPacked() {
+        /// Packs and unpacks the positions before and after, which should
+        /// give back the same positions (counters included), and the same
+        /// units and key with unpackBoard.
+        /// Then flips each bit of the packed position before in turn: the
+        /// result must be rejected, or be a record that packs back the same.
+        PackedPosition packed;
+        for (const Position* pos : {&posBefore, &posAfter}) {
+            if (!pos->toPacked(packed) || !posTest.fromPacked(packed) ||
+                posTest != *pos || posTest.toFen() != pos->toFen()) {
+                return false;
+            }
+            if (!isSameBoard(packed, *pos)) {
+                return false;
+            }
+        }
+        posBefore.toPacked(packed);
+        unsigned char bytes[sizeof(PackedPosition)];
+        for (size_t ibit = 0; ibit < 8 * sizeof(bytes); ++ibit) {
+            std::memcpy(bytes, &packed, sizeof(bytes));
+            bytes[ibit / 8] ^= 1 << (ibit % 8);
+            PackedPosition corrupted;
+            std::memcpy(&corrupted, bytes, sizeof(bytes));
+            if (!posTest.fromPacked(corrupted)) {
+                continue;
+            }
+            PackedPosition repacked;
+            posTest.toPacked(repacked);
+            if (std::memcmp(&repacked, &corrupted, sizeof(bytes)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
     private:
     // To refactor for future use if needed
     Square square(std::string cn) {
@@ -97,7 +215,8 @@ class SingleMoveTest {
 int main(int argc, char* argv[]) {
     if (argc != 3) {
         std::cout << "Run the perft tests with the command [filename] "
-                     "[EPD file path] [0 for Make, 1 for Unmake] "
+                     "[EPD file path] [0 for Make, 1 for Unmake, 2 for FEN "
+                     "parsing, 3 for packing] "
                      "(all arguments required).\n";
         return 0;
     }
@@ -109,8 +228,9 @@ int main(int argc, char* argv[]) {
     
     // Setup
     int mode {std::atoi(argv[2])};
-    if (mode != 0 && mode != 1) {
-        std::cout << "Invalid mode (Make = 0 / Unmake = 1).";
+    if (mode < 0 || mode > 3) {
+        std::cout << "Invalid mode (Make = 0 / Unmake = 1 / FEN = 2 / "
+                     "Packing = 3).";
         return 0;
     }
     
@@ -119,8 +239,6 @@ int main(int argc, char* argv[]) {
     int numTests = 0;
     std::vector<int> idFails;
     
-    initialiseBbLookup();
-    
     // Run each test in the testSuite (parsed from EPD).
     while (std::getline(testSuite, strTest)) {
         ++numTests;
@@ -132,12 +250,29 @@ int main(int argc, char* argv[]) {
             isTestCorrect = test.runMake();
         } else if (mode == 1) {
             isTestCorrect = test.runUnmake();
+        } else if (mode == 2) {
+            isTestCorrect = test.runFen();
+        } else if (mode == 3) {
+            isTestCorrect = test.runPacked();
         }
         if (!isTestCorrect) {
             idFails.push_back(testId);
         }
     }
     testSuite.close();
+    // The malformed FENs follow on from the suite's tests.
+    if (mode == 2) {
+        Position pos;
+        Position posEmpty;
+        posEmpty.reset();
+        for (const BadFenTest& test : BAD_FEN_TESTS) {
+            ++numTests;
+            ++testId;
+            if (pos.parseFen(test.strFen) != test.err || pos != posEmpty) {
+                idFails.push_back(testId);
+            }
+        }
+    }
     
     // Print testing summary
     int numFails = idFails.size();
@@ -0,0 +1,153 @@
+#include "epd_suite.h"
+#include "movegen.h"
+#include "position.h"
+#include "see.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int seeSlow(Square sq, Colour co, PieceType pctyOnSq, Bitboard bbOcc,
+            const Position& pos) {
+    /// What co can win by capturing pctyOnSq on sq, and after it, with the
+    /// units in bbOcc: SEE by recursion, finding the attackers afresh at each
+    /// capture instead of adding x-rays, to check see() against.
+    const Bitboard bbAttackers {attacksTo(sq, bbOcc, pos) & bbOcc};
+    const Bitboard bbOurs {bbAttackers & pos.getUnitsBb(co)};
+    if (!bbOurs) {return 0;}
+    PieceType pcty {PAWN};
+    while (!(bbOurs & pos.getUnitsBb(pcty))) {
+        pcty = static_cast<PieceType>(pcty + 1);
+    }
+    if (pcty == KING && (bbAttackers & pos.getUnitsBb(!co))) {return 0;}
+    const Bitboard bbOccAfter {bbOcc ^ lsb(bbOurs & pos.getUnitsBb(pcty))};
+    return std::max(0, SEE_VALUES[pctyOnSq] -
+                       seeSlow(sq, !co, pcty, bbOccAfter, pos));
+}
+
+int seeReference(Move mv, const Position& pos) {
+    /// see() by seeSlow.
+    if (isCastling(mv)) {return 0;}
+    const Square fromSq {getFromSq(mv)};
+    const Square toSq {getToSq(mv)};
+    Bitboard bbOcc {pos.getUnitsBb() ^ fromSq};
+    PieceType pctyOnSq {getPieceType(pos.getPiece(fromSq))};
+    int gain {0};
+    if (isEp(mv)) {
+        gain = SEE_VALUES[PAWN];
+        bbOcc ^= square(getFileIdx(toSq), getRankIdx(fromSq));
+    } else if (pos.getPiece(toSq) != NO_PIECE) {
+        gain = SEE_VALUES[getPieceType(pos.getPiece(toSq))];
+    }
+    if (isPromotion(mv)) {
+        pctyOnSq = getPromotionType(mv);
+        gain += SEE_VALUES[pctyOnSq] - SEE_VALUES[PAWN];
+    }
+    return gain - seeSlow(toSq, !pos.getSideToMove(), pctyOnSq, bbOcc, pos);
+}
+
+uint64_t perftSee(int depth, Position& pos, bool& isMismatch) {
+    /// Perft, also checking every move at every node: see() must match
+    /// seeReference(), and seeGE() must be true up to see()'s value only.
+    if (depth == 0) {return 1;}
+    Movelist mvlist = generateLegalMoves(pos);
+    uint64_t nodes {0};
+    for (Move mv : mvlist) {
+        const int value {see(mv, pos)};
+        if (value != seeReference(mv, pos) || !seeGE(mv, pos, value) ||
+            !seeGE(mv, pos, value - 1) || seeGE(mv, pos, value + 1)) {
+            isMismatch = true;
+        }
+        pos.makeMove(mv);
+        nodes += perftSee(depth - 1, pos, isMismatch);
+        pos.unmakeMove(mv);
+    }
+    return nodes;
+}
+
+// Exchanges worked out by hand, and see()'s value for each (with seeGE() and
+// seeReference() checked on them too).
+struct SeeTest {
+    std::string strFen;
+    Square fromSq;
+    Square toSq;
+    PieceType promotionType; // NO_PCTY if not a promotion
+    int value;
+};
+const std::vector<SeeTest> SEE_TESTS {
+    // Undefended pawn.
+    {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1",
+     SQ_E1, SQ_E5, NO_PCTY, 100},
+    // Knight for pawn: x-rays on both sides (queen behind bishop, queen
+    // behind rook).
+    {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1",
+     SQ_D3, SQ_E5, NO_PCTY, -200},
+    // Doubled rooks: the rook behind wins the exchange.
+    {"4k3/4r3/4r3/8/8/8/4R3/4R1K1 w - - 0 1",
+     SQ_E2, SQ_E6, NO_PCTY, 500},
+    // A king recaptures, unless the square is defended.
+    {"4k3/8/8/8/2n5/8/3P4/4K3 b - - 0 1",
+     SQ_C4, SQ_D2, NO_PCTY, -200},
+    {"3rk3/8/8/8/2n5/8/3P4/4K3 b - - 0 1",
+     SQ_C4, SQ_D2, NO_PCTY, 100},
+    // Promotions, then the king recapturing the queen.
+    {"4k3/1P6/8/8/8/8/8/4K3 w - - 0 1",
+     SQ_B7, SQ_B8, QUEEN, 800},
+    {"1rk5/P7/8/8/8/8/8/4K3 w - - 0 1",
+     SQ_A7, SQ_B8, QUEEN, 400},
+    // En passant, then recaptured.
+    {"4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1",
+     SQ_E5, SQ_D6, NO_PCTY, 0},
+    // A quiet move onto an attacked square.
+    {"4k3/8/8/4p3/8/8/8/3QK3 w - - 0 1",
+     SQ_D1, SQ_D4, NO_PCTY, -900}
+};
+
+bool runSeeTest(const SeeTest& test) {
+    Position pos;
+    if (pos.parseFen(test.strFen) != FEN_OK) {return false;}
+    for (Move mv : generateLegalMoves(pos)) {
+        const PieceType pcty {isPromotion(mv) ? getPromotionType(mv) : NO_PCTY};
+        if (getFromSq(mv) != test.fromSq || getToSq(mv) != test.toSq ||
+            pcty != test.promotionType) {
+            continue;
+        }
+        return see(mv, pos) == test.value &&
+               seeReference(mv, pos) == test.value &&
+               seeGE(mv, pos, test.value) && !seeGE(mv, pos, test.value + 1);
+    }
+    return false;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cout << "Run the SEE tests with the command [filename] "
+            "[EPD file path] [Maximum depth] (all arguments required).\n"
+            "Counts perft, checking SEE on every move at every node, then "
+            "runs a set of\n"
+            "hand-worked exchanges.\n";
+        return 0;
+    }
+    std::string epdFile {argv[1]};
+    int maxDepth {std::atoi(argv[2])};
+    int numTests = 0;
+    std::vector<int> idFails;
+    runEpdSuite(epdFile, maxDepth, [](int depth, Position& pos) {
+        bool isMismatch {false};
+        const uint64_t nodes {perftSee(depth, pos, isMismatch)};
+        return isMismatch ? 0 : nodes;
+    }, numTests, idFails);
+    // The hand-worked exchanges follow on from the suite's tests.
+    for (const SeeTest& test : SEE_TESTS) {
+        ++numTests;
+        if (!runSeeTest(test)) {
+            idFails.push_back(numTests);
+        }
+    }
+    printSummary(numTests, idFails);
+    return 0;
+}
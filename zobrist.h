@@ -0,0 +1,64 @@
+#ifndef ZOBRIST_INCLUDED
+#define ZOBRIST_INCLUDED
+
+#include "chess_types.h"
+
+#include <array>
+#include <cstdint>
+
+// === zobrist.h ===
+// Random keys for Zobrist hashing of positions. A position's key is the XOR
+// of the keys of its features: each piece on its square, the castling rights,
+// the file of the en passant square (if any), and black to move.
+// The keys are generated at compile time with a fixed seed, so keys (and thus
+// hashes) are identical across builds and runs.
+
+typedef uint64_t Key;
+
+// SplitMix64: small, fast and good enough for hashing keys.
+constexpr Key nextZobristKey(Key& state) {
+    Key z {state += 0x9E3779B97F4A7C15ULL};
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    std::array<std::array<Key, NUM_SQUARES>, NUM_PIECES> pieceSq {};
+    // Indexed by all 16 combinations of CastlingRights.
+    std::array<Key, CASTLE_ALL + 1> castling {};
+    // Indexed by file of the en passant square.
+    std::array<Key, 8> epFile {};
+    Key blackToMove {0};
+};
+
+constexpr ZobristKeys makeZobristKeys() {
+    ZobristKeys keys {};
+    Key state {0x3243F6A8885A308DULL}; // seed: hex digits of pi
+    for (auto& sqKeys : keys.pieceSq) {
+        for (Key& k : sqKeys) {
+            k = nextZobristKey(state);
+        }
+    }
+    // Each castling combination is the XOR of its basic rights' keys.
+    std::array<Key, NUM_CASTLES> basicKeys {};
+    for (Key& k : basicKeys) {
+        k = nextZobristKey(state);
+    }
+    for (int icr = 0; icr <= CASTLE_ALL; ++icr) {
+        for (int i = 0; i < NUM_CASTLES; ++i) {
+            if (icr & CASTLE_LIST[i]) {
+                keys.castling[icr] ^= basicKeys[i];
+            }
+        }
+    }
+    for (Key& k : keys.epFile) {
+        k = nextZobristKey(state);
+    }
+    keys.blackToMove = nextZobristKey(state);
+    return keys;
+}
+
+inline constexpr ZobristKeys ZOBRIST {makeZobristKeys()};
+
+#endif //#ifndef ZOBRIST_INCLUDED
\ No newline at end of file